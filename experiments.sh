@@ -9,7 +9,7 @@ cd ..
 PREFIX="taskset -c 0 $BUILDDIR/src"
 SEED=439569436534
 
-## Usage: mergesorts [reps] [n1,n2,n3] [inputs] [contestants] [seed] [outfile]
+## Usage: mergesorts [reps] [n1,n2,n3] [inputs] [contestants] [seed] [outfile] [threads]
 
 echo "Experiment 2a: 10^7 ints distribution, random runs"
 
@@ -62,6 +62,67 @@ ${PREFIX}/mergesorts-count-cmps  101 100000000 runs-sqrtn '*' ${SEED} times-runs
 
 
 
+echo "Experiment 7: parallel powersort, int, random runs, various thread counts (no pinning)"
+
+# 22: parallel_powersort, 23/24: powersort / powersort_4way with parallel merges
+for PARALLEL_ALGO in 22 23 24
+do
+  for threads in 1 2 4 8 16 32
+  do
+    $BUILDDIR/src/mergesorts 11 100000000 runs-sqrtn $PARALLEL_ALGO ${SEED} times-parallel-100m-int-a$PARALLEL_ALGO-t$threads $threads >> times-parallel-int.out
+  done
+done
+
+
+
+echo "Experiment 8: galloping merges vs. Timsort, int, Timsort-drag and random runs"
+
+# 4: powersort, 18: timsort (gfx), 25-27: powersort / peeksort / trotsort with GALLOPING merges
+for algo in 4 18 25 26 27
+do
+  for runs in 30 300 3000 30000
+  do
+    ${PREFIX}/mergesorts 101 10000000 runs$runs $algo ${SEED} times-gallop-runs$runs-10m-int-a$algo >> times-gallop-int.out
+  done
+  ${PREFIX}/mergesorts 101 10000000 timdrag32 $algo ${SEED} times-gallop-timdrag32-10m-int-a$algo >> times-gallop-int.out
+done
+
+
+
+echo "Experiment 9: time vs. scratch space, int, random runs"
+
+# 4: powersort (n+2 scratch), 30/31: half-size buffer, 32-34: in-place SymMerge (no scratch)
+for algo in 4 30 31 32 33 34
+do
+  ${PREFIX}/mergesorts 101 10000000 runs-sqrtn $algo ${SEED} times-scratch-10m-int-a$algo >> times-scratch-int.out
+done
+
+
+
+echo "Experiment 10: more than 2^32 ints, random runs"
+
+# needs about 45 GB of RAM (input + n-element buffer)
+# 2: powersort_4way, 4: powersort, 6: std::sort, 7: std::stable_sort
+for algo in 2 4 6 7
+do
+  ${PREFIX}/mergesorts 3 5000000000 runs-sqrtn $algo ${SEED} times-runs-5g-int-a$algo >> times-runs-5g-int.out
+done
+
+
+
+echo "Experiment 11: re-sorting after appending k random elements, int"
+
+# 4: powersort, 5: powersort COPY_SMALLER, 35: only sort the k appended elements and merge them in
+for algo in 4 5 35
+do
+  for k in 10 1000 100000
+  do
+    ${PREFIX}/mergesorts 101 10000000 append$k $algo ${SEED} times-append$k-10m-int-a$algo >> times-append-int.out
+  done
+done
+
+
+
 echo "Experiment 6: Cachegrind"
 
 BUILDDIR=cmake-build-relwithdebuginfo
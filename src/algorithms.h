@@ -10,9 +10,56 @@
 #include <ostream>
 #include <string>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 
 namespace algorithms {
 
+	/**
+	 * Scratch space for the buffers of sorters, owned by the caller
+	 * so that it can be reused across calls to sort and across sorters.
+	 *
+	 * The space is raw, uninitialized storage: growing constructs no elements,
+	 * and it never shrinks, so after warm-up sorting does not allocate.
+	 * Merges move-construct elements into it (std::uninitialized_move) and destroy
+	 * them once they are moved back (see buffer_elements), so between merges
+	 * the space holds no elements.
+	 * A scratch_space must only be used by one sort at a time; use one per thread.
+	 */
+	template<typename T>
+	class scratch_space {
+	private:
+		struct deallocate {
+			size_t capacity;
+			void operator()(T *p) const { std::allocator<T>().deallocate(p, capacity); }
+		};
+		std::unique_ptr<T, deallocate> _elements {nullptr, deallocate {0}};
+		size_t _capacity = 0;
+	public:
+		scratch_space() = default;
+		explicit scratch_space(size_t capacity) { get(capacity); }
+
+		/** returns uninitialized space for at least n elements */
+		T *get(size_t n) {
+			if (n > _capacity) {
+				_elements.reset();
+				_elements = {std::allocator<T>().allocate(n), deallocate {n}};
+				_capacity = n;
+			}
+			return _elements.get();
+		}
+
+		size_t capacity() const { return _capacity; }
+	};
+
+
+	/** throws std::length_error if Index cannot hold all indices of an array of n elements */
+	template<typename Index>
+	void check_index_range(size_t n) {
+		if (n > 0 && n - 1 > (size_t) std::numeric_limits<Index>::max())
+			throw std::length_error("too many elements for index type of " + std::to_string(sizeof(Index)) + " bytes");
+	}
 
 	/** superclass for sorting methods */
 	template<typename Iterator>
@@ -30,6 +77,15 @@ namespace algorithms {
 		 */
 		virtual void sort(Iterator begin, Iterator end) = 0;
 
+		/**
+		 * sorts [start..end) like sort(begin, end), but takes any buffers
+		 * from scratch instead of memory owned by the sorter.
+		 * Sorters without buffers ignore scratch.
+		 */
+		virtual void sort(Iterator begin, Iterator end, scratch_space<elem_t> & /* scratch */) {
+			sort(begin, end);
+		}
+
 		void operator()(Iterator begin, Iterator end) {
 			sort(begin, end);
 		}
@@ -41,6 +97,12 @@ namespace algorithms {
 
 		virtual bool is_real_sort() { return true; }
 
+		/**
+		 * number of elements of scratch space (buffers) held after the last sort;
+		 * -1 if the sorter does not track its scratch space.
+		 */
+		virtual long long scratch_elements() const { return -1; }
+
 	};
 
 	/** No-operation dummy implementation of sorter */
@@ -48,11 +110,17 @@ namespace algorithms {
 	struct nop final : sorter<Iterator> {
     private:
         using typename sorter<Iterator>::elem_t;
-        std::vector<elem_t> _buffer;
+        scratch_space<elem_t> _ownScratch;
+        size_t _bufferSize = 0;
     public:
 		void sort(Iterator begin, Iterator end) override {
+			sort(begin, end, _ownScratch);
+		}
+
+		void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
             if (withBuffer) {
-                _buffer.resize(end - begin);
+                _bufferSize = end - begin;
+                scratch.get(_bufferSize);
             }
 			// do nothing
 		}
@@ -64,6 +132,8 @@ namespace algorithms {
 		bool is_real_sort() override {
 			return false;
 		}
+
+		long long scratch_elements() const override { return _bufferSize; }
 	};
 
 
@@ -77,6 +147,8 @@ namespace algorithms {
 		std::string name() const override {
 			return "std::sort";
 		}
+
+		long long scratch_elements() const override { return 0; }
 	};
 
 	/** std::stable_sort implementation of sorter */
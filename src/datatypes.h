@@ -7,6 +7,8 @@
 #include <cassert>
 #include <algorithm>
 #include <random>
+#include <cstdio>
+#include <string>
 #include <iostream>
 
 namespace data {
@@ -101,6 +103,51 @@ namespace data {
         }
     };
 
+    /**
+     * The part of an element that comparisons look at, for sorting keys apart from
+     * the rest of the records (see keyed_powersort); the whole element by default.
+     */
+    template<typename T>
+    struct sort_key {
+        const T &operator()(const T &x) const { return x; }
+    };
+
+    template<int size, typename Int>
+    struct sort_key<blob<size, Int, FIRST_ENTRY>> {
+        Int operator()(const blob<size, Int, FIRST_ENTRY> &x) const { return x.a[0]; }
+    };
+
+    /**
+     * A string key, too long for the small-string optimization,
+     * so that every copy allocates (as for real-world string keys).
+     * Values convert from integers, and compare as those.
+     */
+    class heap_string {
+        std::string _value;
+        static const unsigned long long SIGN_FLIP = 1ull << 63; // makes order of signed values lexicographic
+    public:
+        heap_string(long long value = 0) { // convert from int
+            char digits[24];
+            std::snprintf(digits, sizeof(digits), "%020llu", (unsigned long long) value ^ SIGN_FLIP);
+            _value = std::string("key:") + digits;
+        }
+
+        long long value() const { return (long long) (std::stoull(_value.substr(4)) ^ SIGN_FLIP); }
+
+        bool operator<(const heap_string &rhs) const { return _value < rhs._value; }
+        bool operator==(const heap_string &rhs) const { return _value == rhs._value; }
+        bool operator!=(const heap_string &rhs) const { return !(rhs == *this); }
+        bool operator>(const heap_string &rhs) const { return rhs < *this; }
+        bool operator<=(const heap_string &rhs) const { return !(rhs < *this); }
+        bool operator>=(const heap_string &rhs) const { return !(*this < rhs); }
+
+        friend std::ostream &operator<<(std::ostream &os, const heap_string &s) { return os << s.value(); }
+
+        heap_string &operator+=(heap_string const &rhs) { // increment operator
+            return *this = heap_string(value() + rhs.value());
+        }
+    };
+
 }
 typedef data::blob<8> blob32b;
 typedef data::blob<32> blob128b;
@@ -149,6 +196,17 @@ namespace std {
         static constexpr float_round_style round_style = numeric_limits<int>::round_style;
     };
 
+    // specialize std::numeric-limits for heap_string (as far as needed for sentinels)
+    template<>
+    struct numeric_limits<data::heap_string> {
+        static const bool is_specialized = true;
+        static const data::heap_string min() noexcept { return data::heap_string(numeric_limits<long long>::min()); }
+        static const data::heap_string max() noexcept { return data::heap_string(numeric_limits<long long>::max()); }
+        static const data::heap_string lowest() noexcept { return min(); }
+        static constexpr bool has_infinity = false;
+        static const data::heap_string infinity() noexcept { return max(); }
+    };
+
     // specialize std::numeric-limits for blob
     template<int size, typename Int, data::blob_comparison_function comparisonFunction>
     struct numeric_limits<data::blob<size, Int, comparisonFunction>> {
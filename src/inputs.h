@@ -6,6 +6,7 @@
 #include <random>
 #include <algorithm>
 #include <cassert>
+#include <limits>
 
 namespace inputs {
 
@@ -15,10 +16,16 @@ namespace inputs {
 		return std::uniform_int_distribution<int>(0,m-1)(rng);
 	}
 
+	/** uniform random index in [0..m); gives the same values as next_int for m that fit into int */
+	size_t next_index(size_t m, RNG& rng) {
+		if (m <= (size_t) std::numeric_limits<int>::max()) return next_int(m, rng);
+		return std::uniform_int_distribution<size_t>(0,m-1)(rng);
+	}
+
 	template<typename Iter>
-	void shuffle(Iter A, int n, RNG & random) {
-		std::random_shuffle(A, A + n, [&random](int m) {
-			return next_int(m, random);
+	void shuffle(Iter A, size_t n, RNG & random) {
+		std::random_shuffle(A, A + n, [&random](size_t m) {
+			return next_index(m, random);
 		});
 	}
 
@@ -31,17 +38,20 @@ namespace inputs {
 
     template<typename Elem>
 	struct input_generator {
-		virtual Elem * newInstance(int n, RNG & random) = 0;
-		virtual Elem * next(int n, RNG & random, Elem * A) {
+		virtual Elem * newInstance(size_t n, RNG & random) = 0;
+		virtual Elem * next(size_t n, RNG & random, Elem * A) {
 			return A == nullptr ?
 			       newInstance(n, random) :
 			       reuseInstance(n, A, random);
 		}
-		virtual Elem *reuseInstance(int n, Elem *A, RNG &random) {
+		virtual Elem *reuseInstance(size_t n, Elem *A, RNG &random) {
 			if (A != nullptr) delete[] A;
 			return newInstance(n, random);
 		}
 
+		/** number of elements at the end of the inputs that may be unsorted, if known; otherwise the maximal size_t */
+		virtual size_t unsorted_suffix() const { return std::numeric_limits<size_t>::max(); }
+
 		virtual std::string name() const = 0;
 
 		friend std::ostream &operator<<(std::ostream &os, const input_generator &input_gen) {
@@ -57,15 +67,14 @@ namespace inputs {
 	 * where each length is drawn iid Geo(expRunLen).
 	 */
 	template<typename Iter>
-	void sort_random_runs(Iter begin, Iter end, int expRunLen, RNG & rng) {
+	void sort_random_runs(Iter begin, Iter end, size_t expRunLen, RNG & rng) {
 #ifdef COMPUTE_RUNLENGTH_ENTROPY
         double run_length_entropy = 0;
 #endif
-        std::geometric_distribution<int> distribution(1.0/expRunLen);
+        std::geometric_distribution<size_t> distribution(1.0/expRunLen);
 		for (Iter i = begin; i < end;) {
-            int len = floor(distribution(rng)) + 1;
-            Iter j = i + len;
-            if (j > end) j = end;
+            size_t len = distribution(rng) + 1;
+            Iter j = len < (size_t) (end - i) ? i + len : end;
 #ifdef COMPUTE_RUNLENGTH_ENTROPY
             double l = ((double) (j-i)) / (end - begin);
             run_length_entropy -= l * log2(l);
@@ -84,9 +93,9 @@ namespace inputs {
 	 * requires a conversion from int to Elem.
 	 */
 	template<typename Elem>
-	Elem * new_random_permutation(int n, RNG & rng) {
+	Elem * new_random_permutation(size_t n, RNG & rng) {
 		Elem * A = new Elem[n];
-		for (int i = 1; i <= n; ++i) A[i-1] = i;
+		for (size_t i = 1; i <= n; ++i) A[i-1] = i;
 		shuffle(A, n, rng);
 		return A;
 	}
@@ -94,12 +103,12 @@ namespace inputs {
     template<typename Iter>
     std::vector<Iter> sort_k_random_runs(Iter begin, Iter end, unsigned k, RNG &rng) {
         auto n = end - begin;
-        unsigned dividers[k+1];
+        size_t dividers[k+1];
         dividers[0] = 0;
         dividers[k] = n;
         // random dividers
         for (auto i = 1; i < k; ++i) {
-            dividers[i] = next_int(n, rng);
+            dividers[i] = next_index(n, rng);
         }
         std::sort(dividers, dividers + k+1);
         for (auto i = 0; i < k; ++i) {
@@ -120,11 +129,11 @@ namespace inputs {
 	template<typename Elem>
 	struct random_permutations_generator final : input_generator<Elem> {
 
-		Elem * newInstance(int n, RNG &random) override {
+		Elem * newInstance(size_t n, RNG &random) override {
 			return new_random_permutation<Elem>(n, random);
 		}
 
-		Elem * reuseInstance(int n, Elem *A, RNG &random) override {
+		Elem * reuseInstance(size_t n, Elem *A, RNG &random) override {
 			shuffle(A, n, random);
 			return A;
 		}
@@ -146,17 +155,17 @@ namespace inputs {
 	template<typename Elem>
 	struct random_runs_generator final : input_generator<Elem>
 	{
-		const int _runLen;
+		const size_t _runLen;
 
-		explicit random_runs_generator(const int runLen) : _runLen(runLen) {}
+		explicit random_runs_generator(const size_t runLen) : _runLen(runLen) {}
 
-		Elem *newInstance(int n, RNG &random) override {
+		Elem *newInstance(size_t n, RNG &random) override {
 			Elem * A = new_random_permutation<Elem>(n, random);
 			sort_random_runs(A, A+n-1, _runLen, random);
 			return A;
 		}
 
-		Elem *reuseInstance(int n, Elem *A, RNG &random) override {
+		Elem *reuseInstance(size_t n, Elem *A, RNG &random) override {
 			shuffle(A, n, random);
 			sort_random_runs(A, A+n-1, _runLen, random);
 			return A;
@@ -180,18 +189,18 @@ namespace inputs {
 	struct random_runs_sqrt_n_generator final : input_generator<Elem>
 	{
 
-		Elem *newInstance(int n, RNG &random) override {
+		Elem *newInstance(size_t n, RNG &random) override {
             Elem * A = new_random_permutation<Elem>(n, random);
 			sort_random_runs(A, A+n-1, run_len(n), random);
 			return A;
 		}
 
-        int run_len(int n) const {
-            int sqrt_n = floor(sqrt(n));
+        size_t run_len(size_t n) const {
+            size_t sqrt_n = floor(sqrt(n));
             return sqrt_n;
         }
 
-        Elem *reuseInstance(int n, Elem *A, RNG &random) override {
+        Elem *reuseInstance(size_t n, Elem *A, RNG &random) override {
 			shuffle(A, n, random);
 			sort_random_runs(A, A+n-1, run_len(n), random);
 			return A;
@@ -203,9 +212,43 @@ namespace inputs {
 	};
 
 
+	/**
+	 * sorted arrays with k random elements appended:
+	 * a random permutation of [1..n] where the first n-k elements are sorted.
+	 * (Arrays with n <= k are random permutations.)
+	 *
+	 * requires an (implicit) conversion from int to Elem
+	 **/
+	template<typename Elem>
+	struct sorted_plus_random_generator final : input_generator<Elem>
+	{
+		const size_t _k;
+
+		explicit sorted_plus_random_generator(const size_t k) : _k(k) {}
+
+		Elem *newInstance(size_t n, RNG &random) override {
+			Elem * A = new_random_permutation<Elem>(n, random);
+			std::sort(A, A + (n - std::min(_k, n)));
+			return A;
+		}
+
+		Elem *reuseInstance(size_t n, Elem *A, RNG &random) override {
+			shuffle(A, n, random);
+			std::sort(A, A + (n - std::min(_k, n)));
+			return A;
+		}
+
+		size_t unsorted_suffix() const override { return _k; }
+
+		std::string name() const override {
+			return std::string("sorted-plus-") + std::to_string(_k) + "-random-appended";
+		}
+	};
+
+
 	template<typename num>
-	long total(std::vector<num> l) {
-		long result = 0;
+	num total(std::vector<num> const & l) {
+		num result = 0;
 		for (auto &&x : l) result += x;
 		return result;
 	}
@@ -223,16 +266,16 @@ namespace inputs {
 	 */
 	template<typename Iter>
 	void fill_with_up_and_down_runs(Iter start, Iter end,
-	                                std::vector<int> const & runLengths,
-	                                int runLenFactor, RNG& random) {
-		int n = end - start;
-		assert( total<>(runLengths) * runLenFactor == n);
-		for (int i = 0; i < n; ++i) start[i] = i+1;
+	                                std::vector<size_t> const & runLengths,
+	                                size_t runLenFactor, RNG& random) {
+		auto n = end - start;
+		assert( total<>(runLengths) * runLenFactor == (size_t) n);
+		for (decltype(n) i = 0; i < n; ++i) start[i] = i+1;
 		shuffle(start, n, random);
 		bool reverse = false;
 		Iter i = start;
-		for (int l : runLengths) {
-			int L = l * runLenFactor;
+		for (size_t l : runLengths) {
+			size_t L = l * runLenFactor;
 			std::sort(std::max(start,i-1), i+L);
 			if (reverse) std::reverse(std::max(start,i-1), i+L);
 			reverse = !reverse;
@@ -244,13 +287,13 @@ namespace inputs {
 
 	/** Recursively computes R_Tim(n) (see Buss and Knop 2018) */
 	template<typename Consumer>
-	void compute_timsort_drag_run_lengths(Consumer out, int n) {
+	void compute_timsort_drag_run_lengths(Consumer out, size_t n) {
 		if (n <= 3) {
 			out(n);
 			return;
 		} else {
-			int nPrime = n/2;
-			int nPrimePrime = n - nPrime - (nPrime-1);
+			size_t nPrime = n/2;
+			size_t nPrimePrime = n - nPrime - (nPrime-1);
 			compute_timsort_drag_run_lengths(out, nPrime);
 			compute_timsort_drag_run_lengths(out, nPrime - 1);
 			out(nPrimePrime);
@@ -275,25 +318,25 @@ namespace inputs {
 	template<typename Elem>
 	struct timsort_drag_generator final : input_generator<Elem>
 	{
-		std::vector<int> _RTimCache;
-		int _RTimCacheSize = 0;
-		int _minRunLen;
+		std::vector<size_t> _RTimCache;
+		size_t _RTimCacheSize = 0;
+		size_t _minRunLen;
 
-		explicit timsort_drag_generator(const int minRunLen)
+		explicit timsort_drag_generator(const size_t minRunLen)
 				: _minRunLen(minRunLen) {}
 
-		Elem *newInstance(int n, RNG &random) override {
+		Elem *newInstance(size_t n, RNG &random) override {
 			Elem * A = new Elem[n];
 			reuseInstance(n, A, random);
 			return A;
 		}
 
-		Elem *reuseInstance(int n, Elem *A, RNG &random) override {
-			int nn = n / _minRunLen;
+		Elem *reuseInstance(size_t n, Elem *A, RNG &random) override {
+			size_t nn = n / _minRunLen;
 			if (_RTimCacheSize != nn) {
 				_RTimCache.clear();
 				compute_timsort_drag_run_lengths(
-						[&](int x)->void{_RTimCache.push_back(x);},
+						[&](size_t x)->void{_RTimCache.push_back(x);},
 						nn
 				);
 				_RTimCacheSize = nn;
@@ -4,6 +4,7 @@
 #include <iomanip>
 #include <fstream>
 #include <chrono>
+#include <thread>
 
 #include "algorithms.h"
 #include "inputs.h"
@@ -13,6 +14,11 @@
 #include "sorts/peeksort.h"
 #include "sorts/powersort.h"
 #include "sorts/powersort_4way.h"
+#include "sorts/powersort_kway.h"
+#include "sorts/powersort_parallel.h"
+#include "sorts/keyed_powersort.h"
+#include "sorts/indirect_sort.h"
+#include "sorts/pingpong_powersort.h"
 #include "sorts/timsort.h"
 #include "sorts/trotsort.h"
 #include "sorts/quicksort.h"
@@ -23,7 +29,7 @@
 static bool ABORT_IF_RESULT_NOT_SORTED = true;
 
 template<typename Iterator>
-std::vector<std::unique_ptr<algorithms::sorter<Iterator>>> contestants() {
+std::vector<std::unique_ptr<algorithms::sorter<Iterator>>> contestants(unsigned nThreads, size_t unsortedSuffix) {
 	std::vector<std::unique_ptr<algorithms::sorter<Iterator>>> algos;
     algos.push_back(std::make_unique<algorithms::nop<Iterator>>());
 
@@ -66,13 +72,84 @@ std::vector<std::unique_ptr<algorithms::sorter<Iterator>>> contestants() {
 	algos.push_back(std::make_unique<algorithms::trotsort<Iterator, true>>());
 	algos.push_back(std::make_unique<algorithms::nop<Iterator, true>>());
 
+	algos.push_back(std::make_unique<algorithms::parallel_powersort<Iterator,24,algorithms::COPY_BOTH>>(nThreads));
+	// sequential merge policy, but large merges split over threads
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::COPY_BOTH>>(nThreads));
+	algos.push_back(std::make_unique<algorithms::powersort_4way<Iterator,24,algorithms::GENERAL_BY_STAGES_SPLIT>>(nThreads));
+
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::GALLOPING>>());
+	algos.push_back(std::make_unique<algorithms::peeksort<Iterator,24,false,algorithms::GALLOPING>>());
+	algos.push_back(std::make_unique<algorithms::trotsort<Iterator,false,algorithms::GALLOPING>>());
+
+	// trimming of elements already in place before merging
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::COPY_BOTH,false,
+			algorithms::MOST_SIGNIFICANT_SET_BIT,false,true>>());
+	algos.push_back(std::make_unique<algorithms::powersort_4way<Iterator,24,algorithms::GENERAL_BY_STAGES_SPLIT,false,
+			algorithms::MOST_SIGNIFICANT_SET_BIT4,false,true,true,true>>());
+
+	// only ceil(n/2) scratch space
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::COPY_SMALLER,false,
+			algorithms::MOST_SIGNIFICANT_SET_BIT,false,false,true>>());
+	algos.push_back(std::make_unique<algorithms::powersort_4way<Iterator,24,algorithms::GENERAL_BY_STAGES_SPLIT,false,
+			algorithms::MOST_SIGNIFICANT_SET_BIT4,false,true,true,false,true>>());
+
+	// no scratch space at all
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::IN_PLACE_SYMMERGE>>());
+	algos.push_back(std::make_unique<algorithms::peeksort<Iterator,24,false,algorithms::IN_PLACE_SYMMERGE>>());
+	algos.push_back(std::make_unique<algorithms::bottom_up_mergesort<Iterator,24,true,algorithms::IN_PLACE_SYMMERGE>>());
+
+	// only sorting the unsorted suffix (if known from the inputs), then merging it into the sorted prefix
+	algos.push_back(std::make_unique<algorithms::appended_powersort<Iterator>>(unsortedSuffix));
+
+	// AVX2 bitonic merges for int and long builds, COPY_BOTH otherwise
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::default_merging_method<Iterator>>>());
+
+	// sorting networks (for integral types) resp. binary insertionsort for short runs
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::COPY_BOTH,false,
+			algorithms::MOST_SIGNIFICANT_SET_BIT,false,false,false,algorithms::SORTING_NETWORK>>());
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::COPY_BOTH,false,
+			algorithms::MOST_SIGNIFICANT_SET_BIT,false,false,false,algorithms::BINARY_INSERTIONSORT>>());
+	algos.push_back(std::make_unique<algorithms::peeksort<Iterator,24,false,algorithms::COPY_BOTH,algorithms::SORTING_NETWORK>>());
+	algos.push_back(std::make_unique<algorithms::top_down_mergesort<Iterator,24,true,algorithms::COPY_BOTH,algorithms::SORTING_NETWORK>>());
+	algos.push_back(std::make_unique<algorithms::bottom_up_mergesort<Iterator,24,true,algorithms::COPY_BOTH,algorithms::SORTING_NETWORK>>());
+
+#ifdef INCLUDE_KEYED_POWERSORT
+	// merging only (key, index) pairs, records are permuted once at the end
+	algos.push_back(std::make_unique<algorithms::keyed_powersort<Iterator,data::sort_key<
+			typename std::iterator_traits<Iterator>::value_type>>>());
+#endif // INCLUDE_KEYED_POWERSORT
+
+	// sorting 32- resp. 64-bit indices, records are permuted in place at the end
+	algos.push_back(std::make_unique<algorithms::indirect_sorter<Iterator,uint32_t>>());
+	algos.push_back(std::make_unique<algorithms::indirect_sorter<Iterator,uint64_t>>());
+
+	// K-way powersort, K = 2, 4, 8, 16
+	algos.push_back(std::make_unique<algorithms::powersort_kway<Iterator,2>>());
+	algos.push_back(std::make_unique<algorithms::powersort_kway<Iterator,4>>());
+	algos.push_back(std::make_unique<algorithms::powersort_kway<Iterator,8>>());
+	algos.push_back(std::make_unique<algorithms::powersort_kway<Iterator,16>>());
+
+	// 4-way powersort with loser tree merges
+	algos.push_back(std::make_unique<algorithms::powersort_4way<Iterator,24,algorithms::LOSER_TREE>>());
+
+	// sentinel-free merges with precounted loop lengths (for any type)
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::COPY_BOTH_COUNTED>>());
+	algos.push_back(std::make_unique<algorithms::powersort_4way<Iterator,24,algorithms::WILLEM_COUNTED>>());
+
+	// merging back and forth between array and buffer
+	algos.push_back(std::make_unique<algorithms::pingpong_powersort<Iterator>>());
+
+	// merging from both ends at once
+	algos.push_back(std::make_unique<algorithms::powersort<Iterator,24,algorithms::COPY_BOTH_BIDIRECTIONAL>>());
+	algos.push_back(std::make_unique<algorithms::peeksort<Iterator,24,false,algorithms::COPY_BOTH_BIDIRECTIONAL>>());
+
 	return algos;
 
 }
 
 template<typename Elem>
-void timeSorts(int reps, std::vector<int> sizes, unsigned long seed, inputs::input_generator<Elem> &inputs,
-               std::string outFileName, int onlyRunContestant) {
+void timeSorts(int reps, std::vector<size_t> sizes, unsigned long seed, inputs::input_generator<Elem> &inputs,
+               std::string outFileName, int onlyRunContestant, unsigned nThreads) {
 	std::ofstream csv;
 	std::string filename;
 	{ // Construct filename
@@ -83,7 +160,7 @@ void timeSorts(int reps, std::vector<int> sizes, unsigned long seed, inputs::inp
 		longFilename << std::put_time(&tm, "-%Y-%m-%d_%H-%M-%S");
 		longFilename << "-reps" << reps;
 		longFilename << "-ns";
-		for (int n : sizes) longFilename << "-" << n;
+		for (size_t n : sizes) longFilename << "-" << n;
 		longFilename << "-seed" << seed;
 		longFilename << "-elemT" << typeid(Elem).name();
 		longFilename << ".csv";
@@ -105,7 +182,7 @@ void timeSorts(int reps, std::vector<int> sizes, unsigned long seed, inputs::inp
 	}
 
 
-	auto algos = contestants<Elem *>();
+	auto algos = contestants<Elem *>(nThreads, inputs.unsorted_suffix());
 
 	// Dump config
 	std::cout << "algos =\n";
@@ -113,11 +190,12 @@ void timeSorts(int reps, std::vector<int> sizes, unsigned long seed, inputs::inp
         std::cout << "\t" << i << " : " << algos[i]->name() << "\n";
     std::cout << "reps = " << reps << std::endl;
     std::cout << "sizes = [";
-    for (int size : sizes) std::cout << size << " ";
+    for (size_t size : sizes) std::cout << size << " ";
     std::cout << "]" << std::endl;
     std::cout << "inputs = " << inputs << std::endl;
     std::cout << "onlyRunContestant = " << onlyRunContestant << std::endl;
     std::cout << "seed = " << seed << std::endl;
+    std::cout << "threads = " << nThreads << std::endl;
 	std::cout << "Writing to " << filename << std::endl;
 	std::cout << "Sorting " << typeid(Elem).name() << "s (" << sizeof(Elem) << " byte each)" << std::endl;
 
@@ -127,7 +205,7 @@ void timeSorts(int reps, std::vector<int> sizes, unsigned long seed, inputs::inp
 	for (auto &&algo : algos) {
         if (0 <= onlyRunContestant && onlyRunContestant < algos.size() && algoId++ != onlyRunContestant) continue;
 		inputs::RNG rng(seed);
-		for (int size : sizes) {
+		for (size_t size : sizes) {
 			util::welford_variance samples;
 			Elem total = 0;
 			Elem *input = inputs.next(size, rng, nullptr);
@@ -161,7 +239,10 @@ void timeSorts(int reps, std::vector<int> sizes, unsigned long seed, inputs::inp
 					csv.flush();
 				}
 			}
-			std::cout << "avg-ms=" << samples.meanSignificantDigits() << ",\t algo=" << algo->name() << ", n=" << size << "     (" << total<<")\t" << samples << std::endl;
+			std::cout << "avg-ms=" << samples.meanSignificantDigits() << ",\t algo=" << algo->name() << ", n=" << size << "     (" << total<<")\t" << samples;
+			if (algo->scratch_elements() >= 0)
+				std::cout << "\tscratch=" << algo->scratch_elements() << " elements";
+			std::cout << std::endl;
 
 			delete[] input;
 		}
@@ -189,21 +270,21 @@ int main(int argc, char **argv) {
     std::cout << std::boolalpha; // format bool as true/false
 
 	if (argc == 1) {
-		std::cout << "Usage: mergesorts [reps] [n1,n2,n3] [inputs] [contestants] [seed] [outfile]" << std::endl;
+		std::cout << "Usage: mergesorts [reps] [n1,n2,n3] [inputs] [contestants] [seed] [outfile] [threads]" << std::endl;
 	}
 
 	int reps = 11;
 	if (argc >= 2) {
 		reps = std::atoi(argv[1]);
 	}
-	std::vector<int> sizes{10000000};
+	std::vector<size_t> sizes{10000000};
 	if (argc >= 3) {
 		sizes.clear();
 		std::stringstream ns { argv[2] };
 		while (ns.good()) {
 			std::string substr;
 			std::getline( ns, substr, ',' );
-			sizes.push_back( std::stoi(substr) );
+			sizes.push_back( std::stoull(substr) );
 		}
 	}
 	inputs::input_generator<elem_t> *inputs =
@@ -218,11 +299,14 @@ int main(int argc, char **argv) {
                 inputs = new inputs::random_runs_sqrt_n_generator<elem_t>();
             else // runsNNNN
                 inputs = new inputs::random_runs_generator<elem_t>(
-                        std::stoi(ins.substr(4)));
+                        std::stoull(ins.substr(4)));
         }
+		if (ins.substr(0,6) == "append") // appendK
+			inputs = new inputs::sorted_plus_random_generator<elem_t>(
+					std::stoull(ins.substr(6)));
 		if (ins.substr(0,7) == "timdrag")
 			inputs = new inputs::timsort_drag_generator<elem_t>(
-					std::stoi(ins.substr(7)));
+					std::stoull(ins.substr(7)));
 
 	}
     int onlyRunContestant = -1;
@@ -244,7 +328,11 @@ int main(int argc, char **argv) {
 	if (argc >= 7) {
 		filename = std::string(argv[6]);
 	}
-    timeSorts<elem_t>(reps, sizes, seed, *inputs, filename, onlyRunContestant);
+    unsigned nThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc >= 8) {
+        nThreads = std::atoi(argv[7]);
+    }
+    timeSorts<elem_t>(reps, sizes, seed, *inputs, filename, onlyRunContestant, nThreads);
 
 	delete inputs;
 
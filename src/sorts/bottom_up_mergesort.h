@@ -5,11 +5,12 @@
 
 #include "../algorithms.h"
 #include "insertionsort.h"
+#include "small_sort.h"
 #include "merging.h"
 
 /**
  * Simple bottom-up mergesort implementation.
- * Merging starts after forming runs of length minRunLen.
+ * Merging starts after forming runs of length minRunLen with smallSortMethod (see small_sort.h).
  * If doSortedCheck is true, we check if two runs are by chance already
  * in sorted order before two runs are merged (compare last of left run with
  * first of right run)
@@ -19,16 +20,23 @@
 namespace algorithms {
 
 	template<typename Iterator, unsigned int minRunLen = 24, bool doSortedCheck = true,
-	        merging_methods mergingMethod = COPY_BOTH >
+	        merging_methods mergingMethod = COPY_BOTH, small_sort_methods smallSortMethod = INSERTIONSORT>
 	class bottom_up_mergesort final : public sorter<Iterator> {
 	private:
 		using typename sorter<Iterator>::elem_t;
 		using typename sorter<Iterator>::diff_t;
-		std::vector<elem_t> _buffer;
+		scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+		elem_t *_buffer = nullptr;
+		size_t _bufferSize = 0;
 	public:
 
 		void sort(Iterator begin, Iterator end) override {
-			_buffer.resize(end - begin);
+			sort(begin, end, _ownScratch);
+		}
+
+		void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
+			_bufferSize = uses_buffer(mergingMethod) ? end - begin : 0;
+			_buffer = scratch.get(_bufferSize);
 			mergesort(begin, end);
 		}
 
@@ -38,20 +46,23 @@ namespace algorithms {
 			if (minRunLen != 1) {
 				Iterator i = begin;
 				for (size_t len = minRunLen; i < end; i += len)
-					insertionsort(i, std::min(i+len, end));
+					small_sort<smallSortMethod>(i, std::min(i+len, end));
 			}
 			for (size_t len = minRunLen; len < n; len *= 2)
 				for (Iterator i = begin; i < end - len; i += len + len) {
 					Iterator m = i + len;
 					if (!doSortedCheck || *(m-1) > *m)
-						merge_runs<mergingMethod>(i, m, std::min(i + len + len, end), _buffer.begin());
+						merge_runs<mergingMethod>(i, m, std::min(i + len + len, end), _buffer);
 				}
 		}
 
+        long long scratch_elements() const override { return _bufferSize; }
+
         std::string name() const override {
             return "BottomUpMergesort+minRunLen=" + std::to_string(minRunLen) +
                    "+checkSorted=" + std::to_string(doSortedCheck) +
-                   "+mergingMethod=" + to_string(mergingMethod);
+                   "+mergingMethod=" + to_string(mergingMethod) +
+                   (smallSortMethod != INSERTIONSORT ? "+smallSort=" + to_string(smallSortMethod) : "");
         }
 	};
 
@@ -0,0 +1,258 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_EXTERNAL_POWERSORT_H
+#define MERGESORTS_EXTERNAL_POWERSORT_H
+
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "powersort.h"
+
+namespace algorithms {
+
+	/**
+	 * Out-of-core Powersort for files of fixed-width records of type T,
+	 * stored as raw bytes (so T must be trivially copyable) and ordered by operator<.
+	 *
+	 * The input is read in chunks of chunkElements records; each chunk is sorted in memory
+	 * by powersort and spilled to a temporary file.
+	 * A chunk that continues the previous run (its first record is not smaller than the
+	 * last record of the run) is appended to that run without any merge;
+	 * runs are hence lists of spilled files.
+	 * Runs are merged pairwise on disk, in the order given by the node powers of their
+	 * global positions in the input (as in powersort::power_sort_paper),
+	 * so the number of records read and written by merges is within Powersort's
+	 * nearly-optimal merge cost bound for the (chunk-level) run lengths.
+	 * Merges stream their runs through buffers of ioBufferElements records;
+	 * the last merge writes directly to the output file.
+	 *
+	 * Temporary files are named tmpPrefix followed by a number (default: output file name + ".run");
+	 * I/O errors throw std::runtime_error.
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename T, typename ChunkSorter = powersort<T *>>
+	class external_powersort {
+		static_assert(std::is_trivially_copyable<T>::value, "records are read and written as raw bytes");
+	private:
+		const size_t _chunkElements, _ioBufferElements;
+		const std::string _tmpPrefix;
+		std::string _runPrefix; // _tmpPrefix or default for current sort
+		ChunkSorter _chunkSorter;
+		std::vector<T> _chunk;
+		size_t _nextFileId = 0;
+		size_t _mergeCost = 0;
+
+		using file_ptr = std::unique_ptr<FILE, int (*)(FILE *)>;
+
+		static file_ptr open(const std::string &fileName, const char *mode) {
+			file_ptr f(std::fopen(fileName.c_str(), mode), &std::fclose);
+			if (!f) throw std::runtime_error("cannot open " + fileName);
+			return f;
+		}
+
+		/** a run [begin, end) of the input, stored in (the concatenation of) files */
+		struct run {
+			size_t begin, end;
+			std::vector<std::string> files;
+			T last; // largest record
+		};
+
+		struct run_n_power {
+			run r;
+			power_t power;
+		};
+
+		/** reads the records of a run sequentially */
+		class run_reader {
+			const std::vector<std::string> &_files;
+			size_t _nextFile = 0;
+			file_ptr _file {nullptr, &std::fclose};
+			std::vector<T> _buffer;
+			size_t _pos = 0, _filled = 0;
+		public:
+			run_reader(const run &r, size_t bufferElements) : _files(r.files), _buffer(bufferElements) { refill(); }
+
+			bool empty() const { return _pos == _filled; }
+			const T &head() const { return _buffer[_pos]; }
+			void pop() { if (++_pos == _filled) refill(); }
+
+		private:
+			void refill() {
+				_pos = _filled = 0;
+				while (_filled == 0) {
+					if (!_file) {
+						if (_nextFile == _files.size()) return;
+						_file = open(_files[_nextFile++], "rb");
+					}
+					_filled = std::fread(_buffer.data(), sizeof(T), _buffer.size(), _file.get());
+					if (_filled < _buffer.size()) _file.reset();
+				}
+			}
+		};
+
+		/** writes records sequentially to a file; close must be called after the last push */
+		class run_writer {
+			file_ptr _file;
+			std::vector<T> _buffer;
+			size_t _filled = 0;
+		public:
+			run_writer(const std::string &fileName, size_t bufferElements)
+					: _file(open(fileName, "wb")), _buffer(bufferElements) {}
+
+			void push(const T &x) {
+				_buffer[_filled++] = x;
+				if (_filled == _buffer.size()) flush();
+			}
+
+			void flush() {
+				if (std::fwrite(_buffer.data(), sizeof(T), _filled, _file.get()) != _filled)
+					throw std::runtime_error("cannot write run");
+				_filled = 0;
+			}
+
+			void close() {
+				flush();
+				if (std::fclose(_file.release()) != 0) throw std::runtime_error("cannot write run");
+			}
+		};
+
+		std::string new_file_name() {
+			return _runPrefix + std::to_string(_nextFileId++);
+		}
+
+		static void remove_files(const run &r) {
+			for (const auto &file : r.files) std::remove(file.c_str());
+		}
+
+		/** stable merge of adjacent runs a and b into file outFile */
+		run merge(const run &a, const run &b, const std::string &outFile) {
+			assert(a.end == b.begin);
+			{
+				run_reader ra(a, _ioBufferElements), rb(b, _ioBufferElements);
+				run_writer out(outFile, _ioBufferElements);
+				while (!ra.empty() && !rb.empty()) {
+					if (rb.head() < ra.head()) { out.push(rb.head()); rb.pop(); }
+					else { out.push(ra.head()); ra.pop(); }
+				}
+				for (; !ra.empty(); ra.pop()) out.push(ra.head());
+				for (; !rb.empty(); rb.pop()) out.push(rb.head());
+				out.close();
+			}
+			_mergeCost += b.end - a.begin;
+			remove_files(a);
+			remove_files(b);
+			return {a.begin, b.end, {outFile}, b.last < a.last ? a.last : b.last};
+		}
+
+		/**
+		 * reads, sorts and spills chunks starting at position begin
+		 * until one does not continue the run; returns the run.
+		 * The first chunk of the next run (if any) is left in _chunk.
+		 */
+		run next_run(FILE *in, size_t begin, size_t n) {
+			run r {begin, begin, {}, T()};
+			while (r.end < n) {
+				if (_chunk.empty()) read_chunk(in, std::min(_chunkElements, n - r.end));
+				if (!r.files.empty() && _chunk.front() < r.last) break;
+				r.files.push_back(new_file_name());
+				file_ptr out = open(r.files.back(), "wb");
+				if (std::fwrite(_chunk.data(), sizeof(T), _chunk.size(), out.get()) != _chunk.size()
+				    || std::fclose(out.release()) != 0)
+					throw std::runtime_error("cannot write run");
+				r.end += _chunk.size();
+				r.last = _chunk.back();
+				_chunk.clear();
+			}
+			return r;
+		}
+
+		void read_chunk(FILE *in, size_t len) {
+			_chunk.resize(len);
+			if (std::fread(_chunk.data(), sizeof(T), len, in) != len)
+				throw std::runtime_error("cannot read input");
+			_chunkSorter.sort(_chunk.data(), _chunk.data() + len);
+		}
+
+		/** writes the records of r to outFile, by renaming if possible */
+		void move_to(const run &r, const std::string &outFile) {
+			if (r.files.size() == 1) {
+				std::error_code error;
+				std::filesystem::rename(r.files[0], outFile, error);
+				if (!error) return;
+			}
+			{
+				run_reader in(r, _ioBufferElements);
+				run_writer out(outFile, _ioBufferElements);
+				for (; !in.empty(); in.pop()) out.push(in.head());
+				out.close();
+			}
+			remove_files(r);
+		}
+
+	public:
+
+		/**
+		 * chunkElements records are sorted in memory at a time,
+		 * merges use 3 buffers of ioBufferElements records.
+		 */
+		explicit external_powersort(size_t chunkElements, size_t ioBufferElements = 1 << 16,
+		                            std::string tmpPrefix = "")
+				: _chunkElements(std::max<size_t>(chunkElements, 1)),
+				  _ioBufferElements(std::max<size_t>(ioBufferElements, 1)),
+				  _tmpPrefix(std::move(tmpPrefix)) {}
+
+		/** sorts the records in file inFile into file outFile (which must be a different file) */
+		void sort(const std::string &inFile, const std::string &outFile) {
+			_runPrefix = _tmpPrefix.empty() ? outFile + ".run" : _tmpPrefix;
+			const size_t fileSize = std::filesystem::file_size(inFile);
+			if (fileSize % sizeof(T) != 0) throw std::runtime_error(inFile + " does not consist of whole records");
+			const size_t n = fileSize / sizeof(T);
+			_mergeCost = 0;
+			_nextFileId = 0;
+			if (n == 0) {
+				open(outFile, "wb");
+				return;
+			}
+			file_ptr in = open(inFile, "rb");
+			_chunk.clear();
+
+			// power_sort_paper with runs on disk
+			std::vector<run_n_power> stack;
+			stack.reserve(floor_log2(n) + 1);
+			run runA = next_run(in.get(), 0, n);
+			while (runA.end < n) {
+				run runB = next_run(in.get(), runA.end, n);
+				power_t power = node_power_clz(0, n, runA.begin, runB.begin, runB.end);
+				// Invariant: powers on stack must be increasing from bottom to top
+				while (!stack.empty() && stack.back().power > power) {
+					runA = merge(stack.back().r, runA, new_file_name());
+					stack.pop_back();
+				}
+				stack.push_back({std::move(runA), power});
+				runA = std::move(runB);
+			}
+			while (!stack.empty()) {
+				runA = merge(stack.back().r, runA, stack.size() == 1 ? outFile : new_file_name());
+				stack.pop_back();
+			}
+			if (runA.files.size() != 1 || runA.files[0] != outFile) move_to(runA, outFile);
+		}
+
+		/** number of records written by merges in the last call to sort */
+		size_t merge_cost() const { return _mergeCost; }
+
+		std::string name() const {
+			return "ExternalPowerSort+chunkElements=" + std::to_string(_chunkElements) +
+			       "+chunkSorter=" + _chunkSorter.name();
+		}
+	};
+
+}
+
+#endif //MERGESORTS_EXTERNAL_POWERSORT_H
@@ -0,0 +1,189 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_INDIRECT_SORT_H
+#define MERGESORTS_INDIRECT_SORT_H
+
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "../algorithms.h"
+#include "powersort.h"
+#include "work_stealing_pool.h"
+
+namespace algorithms {
+
+	/**
+	 * the index of a record; compares by the records.
+	 * The records are found via a base pointer that is bound per thread for the duration
+	 * of a sort (see bind_records), so that an indirect_index is no larger than Index.
+	 * Tasks of a work_stealing_pool inherit the base pointer from the thread spawning them,
+	 * so a parallel Sorter can compare indices in its worker threads.
+	 */
+	template<typename T, typename Index>
+	struct indirect_index {
+		Index index;
+
+		inline static thread_local const T *records = nullptr;
+
+		/** makes records point to r in this thread (and tasks it spawns) while the result lives */
+		static thread_binding bind_records(const T *r) {
+			return {[] { return (const void *) records; },
+			        [](const void *p) { records = static_cast<const T *>(p); }, r};
+		}
+
+		const T &record() const { return records[index]; }
+
+		bool operator<(const indirect_index &rhs) const { return record() < rhs.record(); }
+		bool operator>(const indirect_index &rhs) const { return rhs.record() < record(); }
+		bool operator<=(const indirect_index &rhs) const { return !(rhs.record() < record()); }
+		bool operator>=(const indirect_index &rhs) const { return !(record() < rhs.record()); }
+	};
+
+	/** a pointer to a record, comparing by the record; used instead of 64-bit indices */
+	template<typename T>
+	struct indirect_pointer {
+		const T *record;
+
+		bool operator<(const indirect_pointer &rhs) const { return *record < *rhs.record; }
+		bool operator>(const indirect_pointer &rhs) const { return *rhs.record < *record; }
+		bool operator<=(const indirect_pointer &rhs) const { return !(*rhs.record < *record); }
+		bool operator>=(const indirect_pointer &rhs) const { return !(*record < *rhs.record); }
+	};
+
+	/**
+	 * moves records[order[i]] to position i, for all i in [0,n), in place:
+	 * each cycle of the permutation is rotated with a single temporary element, so every
+	 * record is moved once (plus one extra move per cycle).
+	 * order must be a permutation of [0,n); it is overwritten with the identity
+	 * to mark the positions that are done.
+	 */
+	template<typename Iter, typename Index>
+	void permute_in_place(Iter records, Index *order, size_t n) {
+		typedef typename std::iterator_traits<Iter>::value_type T;
+		for (size_t i = 0; i < n; ++i) {
+			if (order[i] == i) continue;
+			T tmp = std::move(*(records + i));
+			size_t j = i;
+			for (size_t k = order[j]; k != i; k = order[j]) {
+				*(records + j) = std::move(*(records + k));
+				order[j] = (Index) j;
+				j = k;
+			}
+			*(records + j) = std::move(tmp);
+			order[j] = (Index) j;
+		}
+	}
+
+	/**
+	 * Stable argsort: computes the permutation that sorts [begin,end), i.e., indices
+	 * p[0..n) such that begin[p[0]], begin[p[1]], ... are in sorted order and equal
+	 * elements are in the order of their positions.
+	 * Sorter (powersort by default; powersort_4way works as well, with a merging
+	 * method without sentinels) sorts the indices directly, with comparisons looking
+	 * through to the keys: it finds the runs in the key column and merges only indices,
+	 * (key, index) pairs are never materialized.
+	 * If Index is as large as a pointer, Sorter sorts pointers to the records
+	 * (indirect_pointer) instead, which need no base pointer.
+	 * Iterator must be contiguous (a pointer or vector iterator); Index must be able to hold n.
+	 * Sorter may be multithreaded if it uses work_stealing_pool (e.g. parallel_powersort).
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename Iterator,
+			typename Index = uint32_t,
+			template<typename> class Sorter = powersort
+	>
+	class argsorter {
+	private:
+		typedef typename std::iterator_traits<Iterator>::value_type elem_t;
+		static constexpr bool sortPointers = sizeof(Index) >= sizeof(const elem_t *);
+		typedef std::conditional_t<sortPointers, indirect_pointer<elem_t>, indirect_index<elem_t, Index>> index_t;
+		std::vector<index_t> _indices;
+		Sorter<index_t *> _sorter;
+
+	public:
+
+		/** passes args to the constructor of Sorter */
+		template<typename... Args>
+		explicit argsorter(Args &&... args) : _sorter(std::forward<Args>(args)...) {}
+
+		/** writes the sorting permutation of [begin,end) to permutation[0..n) */
+		void sort_permutation(Iterator begin, Iterator end, Index *permutation) {
+			const size_t n = end - begin;
+			if (n == 0) return;
+			check_index_range<Index>(n);
+			_indices.resize(n);
+			const elem_t *records = &*begin;
+			if constexpr (sortPointers) {
+				for (size_t i = 0; i < n; ++i) _indices[i].record = records + i;
+				_sorter.sort(_indices.data(), _indices.data() + n);
+				for (size_t i = 0; i < n; ++i) permutation[i] = (Index) (_indices[i].record - records);
+			} else {
+				for (size_t i = 0; i < n; ++i) _indices[i].index = (Index) i;
+				{
+					const thread_binding binding = index_t::bind_records(records);
+					_sorter.sort(_indices.data(), _indices.data() + n);
+				}
+				for (size_t i = 0; i < n; ++i) permutation[i] = _indices[i].index;
+			}
+		}
+
+		/** returns the sorting permutation of [begin,end) */
+		std::vector<Index> sort_permutation(Iterator begin, Iterator end) {
+			std::vector<Index> permutation(end - begin);
+			sort_permutation(begin, end, permutation.data());
+			return permutation;
+		}
+
+		std::string name() const {
+			return "Argsort+indexBytes=" + std::to_string(sizeof(Index)) + "+" + _sorter.name();
+		}
+	};
+
+	/** returns the stable sorting permutation of [begin,end), see argsorter */
+	template<typename Index = uint32_t, template<typename> class Sorter = powersort, typename Iterator>
+	std::vector<Index> stable_argsort(Iterator begin, Iterator end) {
+		return argsorter<Iterator, Index, Sorter>().sort_permutation(begin, end);
+	}
+
+	/**
+	 * Indirect sorting: the sorting permutation of the records is computed by argsorter
+	 * (with Sorter on 32-bit indices or pointers), then the records are moved into place
+	 * once by permute_in_place.
+	 * For large records (such as data::blob<32>), this trades a memory indirection per
+	 * comparison for moving only indices in all merges.
+	 * Iterator must be contiguous (a pointer or vector iterator).
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename Iterator,
+			typename Index = uint32_t,
+			template<typename> class Sorter = powersort
+	>
+	class indirect_sorter final : public sorter<Iterator> {
+	private:
+		argsorter<Iterator, Index, Sorter> _argsorter;
+		std::vector<Index> _order;
+
+	public:
+
+		void sort(Iterator begin, Iterator end) override {
+			const size_t n = end - begin;
+			if (n < 2) return;
+			_order.resize(n);
+			_argsorter.sort_permutation(begin, end, _order.data());
+			permute_in_place(begin, _order.data(), n);
+		}
+
+		std::string name() const override {
+			return "Indirect+" + _argsorter.name();
+		}
+	};
+
+}
+
+#endif //MERGESORTS_INDIRECT_SORT_H
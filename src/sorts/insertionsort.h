@@ -7,6 +7,7 @@
 #include <iterator>
 #include <algorithm>
 #include <cassert>
+#include <utility>
 
 namespace algorithms
 {
@@ -19,14 +20,14 @@ namespace algorithms
 	void insertionsort(Iter begin, Iter end, Iter beginUnsorted)
 	{
 		assert(begin <= beginUnsorted && begin <= end);
-		for (Iter i = beginUnsorted; i < end; ++i) {
-			Iter j = i; const auto v = *i;
+		for (Iter i = std::max(beginUnsorted, begin+1); i < end; ++i) {
+			Iter j = i; auto v = std::move(*i);
 			while (v < *(j-1)) {
-				*j = *(j-1);
+				*j = std::move(*(j-1));
 				--j;
 				if (j <= begin) break;
 			}
-			*j = v;
+			*j = std::move(v);
 		}
 	}
 
@@ -50,10 +51,10 @@ namespace algorithms
 		assert(begin <= beginUnsorted && begin <= end);
 		for (Iter i = std::max(beginUnsorted, begin+1); i < end; ++i) {
 			assert(begin <= i);
-			const auto pivot = *i;
+			auto pivot = std::move(*i);
 			Iter const pos = std::upper_bound(begin, i, pivot, std::less<>());
-			for (auto p = i; p > pos; --p) *p = *(p - 1);
-			*pos = pivot;
+			for (auto p = i; p > pos; --p) *p = std::move(*(p - 1));
+			*pos = std::move(pivot);
 		}
 
 	}
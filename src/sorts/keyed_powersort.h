@@ -0,0 +1,204 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_KEYED_POWERSORT_H
+#define MERGESORTS_KEYED_POWERSORT_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "../algorithms.h"
+#include "powersort.h"
+
+namespace algorithms {
+
+	/**
+	 * a sort key with the index of its record; compares by key only.
+	 * For arithmetic keys, it is packed to 4-byte alignment, so that e.g. keyed_index<long, uint32_t>
+	 * takes 12 bytes instead of being padded to the 16 bytes of a full record with pointer;
+	 * other keys (such as strings) keep their natural alignment.
+	 */
+	template<typename Key, typename Index, typename = void>
+	struct keyed_index {
+		Key key;
+		Index index;
+	};
+
+#pragma pack(push, 4)
+	template<typename Key, typename Index>
+	struct keyed_index<Key, Index, std::enable_if_t<std::is_arithmetic<Key>::value>> {
+		Key key;
+		Index index;
+	};
+#pragma pack(pop)
+	static_assert(sizeof(keyed_index<long, uint32_t>) == sizeof(long) + sizeof(uint32_t),
+	              "keyed_index should not be padded");
+	static_assert(alignof(keyed_index<std::string, uint32_t>) == alignof(std::string),
+	              "keyed_index must not misalign non-arithmetic keys");
+
+	template<typename Key, typename Index, typename P>
+	bool operator<(const keyed_index<Key, Index, P> &lhs, const keyed_index<Key, Index, P> &rhs) {
+		return lhs.key < rhs.key;
+	}
+	template<typename Key, typename Index, typename P>
+	bool operator>(const keyed_index<Key, Index, P> &lhs, const keyed_index<Key, Index, P> &rhs) {
+		return rhs.key < lhs.key;
+	}
+	template<typename Key, typename Index, typename P>
+	bool operator<=(const keyed_index<Key, Index, P> &lhs, const keyed_index<Key, Index, P> &rhs) {
+		return !(rhs.key < lhs.key);
+	}
+	template<typename Key, typename Index, typename P>
+	bool operator>=(const keyed_index<Key, Index, P> &lhs, const keyed_index<Key, Index, P> &rhs) {
+		return !(lhs.key < rhs.key);
+	}
+
+}
+
+namespace std {
+	// specialize std::numeric-limits for keyed_index (as far as needed for sentinels)
+	template<typename Key, typename Index>
+	struct numeric_limits<algorithms::keyed_index<Key, Index>> {
+		static const bool is_specialized = numeric_limits<Key>::is_specialized;
+		static const algorithms::keyed_index<Key, Index> min() noexcept { return {numeric_limits<Key>::min(), 0}; }
+		static const algorithms::keyed_index<Key, Index> max() noexcept { return {numeric_limits<Key>::max(), 0}; }
+		static const algorithms::keyed_index<Key, Index> lowest() noexcept { return {numeric_limits<Key>::lowest(), 0}; }
+		static constexpr bool has_infinity = numeric_limits<Key>::has_infinity;
+		static const algorithms::keyed_index<Key, Index> infinity() noexcept { return {numeric_limits<Key>::infinity(), 0}; }
+	};
+}
+
+namespace algorithms {
+
+	/**
+	 * moves payload[order[i].index] to position i, for all i in [0,n),
+	 * using tmp as scratch space (uninitialized storage) for n elements
+	 */
+	template<typename Payload, typename KeyedIndex, typename TmpIter>
+	void permute_by_index(Payload *payload, const KeyedIndex *order, size_t n, TmpIter tmp) {
+		for (size_t i = 0; i < n; ++i) construct_in_buffer(tmp + i, std::move(payload[order[i].index]));
+		std::move(tmp, tmp + n, payload);
+		std::destroy(tmp, tmp + n);
+	}
+
+	/** raw scratch space for payloads of any (not over-aligned) type */
+	typedef scratch_space<std::max_align_t> payload_scratch;
+
+	/**
+	 * Powersort for keys with separate ("structure of arrays") payloads:
+	 * sort(keys, keysEnd, payloads...) sorts the keys stably and permutes each of
+	 * the parallel payload arrays accordingly.
+	 *
+	 * The merges only move keys with a compact index of type Index (which must be able
+	 * to hold n; otherwise sort throws std::length_error); the payloads are permuted
+	 * once at the end. So for large payloads, the memory traffic of each merge level
+	 * drops by the record-to-(key+index) size ratio.
+	 * The payloads of all types share one scratch_space (of type payload_scratch),
+	 * so repeated sorts do not allocate.
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename Key,
+			unsigned int minRunLen = 24,
+			merging_methods mergingMethod = merging_methods::COPY_BOTH,
+			typename Index = uint32_t
+	>
+	class soa_powersort {
+	private:
+		typedef keyed_index<Key, Index> tagged_t;
+		std::vector<tagged_t> _tagged;
+		powersort<tagged_t *, minRunLen, mergingMethod> _powersort;
+		payload_scratch _ownScratch; // used unless scratch is passed to sort
+
+		template<typename Payload>
+		void permute(Payload *payload, payload_scratch &scratch) {
+			static_assert(alignof(Payload) <= alignof(std::max_align_t), "over-aligned payload");
+			const size_t n = _tagged.size();
+			const size_t words = (n * sizeof(Payload) + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+			permute_by_index(payload, _tagged.data(), n, reinterpret_cast<Payload *>(scratch.get(words)));
+		}
+
+	public:
+
+		template<typename... Payloads>
+		void sort(Key *begin, Key *end, Payloads *... payloads) {
+			sort(begin, end, _ownScratch, payloads...);
+		}
+
+		/** as sort(begin, end, payloads...), but permutes the payloads via scratch */
+		template<typename... Payloads>
+		void sort(Key *begin, Key *end, payload_scratch &scratch, Payloads *... payloads) {
+			const size_t n = end - begin;
+			check_index_range<Index>(n);
+			_tagged.resize(n);
+			for (size_t i = 0; i < n; ++i) _tagged[i] = {std::move(begin[i]), (Index) i};
+			_powersort.sort(_tagged.data(), _tagged.data() + n);
+			for (size_t i = 0; i < n; ++i) begin[i] = std::move(_tagged[i].key);
+			(permute(payloads, scratch), ...);
+		}
+
+		std::string name() const {
+			return "SoAPowerSort+minRunLen=" + std::to_string(minRunLen) +
+			       "+mergingMethod=" + to_string(mergingMethod) +
+			       "+indexBytes=" + std::to_string(sizeof(Index));
+		}
+	};
+
+	/**
+	 * Powersort for arrays of records (array of structs) that are only compared by a part
+	 * of the record, the sort key given by KeyOf (i.e., a < b iff KeyOf()(a) < KeyOf()(b)).
+	 *
+	 * As in soa_powersort, merges only move (key, index) pairs (Index must be able to hold n), and
+	 * the records are permuted once at the end (using n elements of scratch space).
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename Iterator,
+			typename KeyOf,
+			unsigned int minRunLen = 24,
+			merging_methods mergingMethod = merging_methods::COPY_BOTH,
+			typename Index = uint32_t
+	>
+	class keyed_powersort final : public sorter<Iterator> {
+	private:
+		using typename sorter<Iterator>::elem_t;
+		typedef std::decay_t<decltype(KeyOf()(std::declval<const elem_t &>()))> key_t;
+		typedef keyed_index<key_t, Index> tagged_t;
+		scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+		size_t _bufferSize = 0;
+		std::vector<tagged_t> _tagged;
+		powersort<tagged_t *, minRunLen, mergingMethod> _powersort;
+
+	public:
+
+		void sort(Iterator begin, Iterator end) override {
+			sort(begin, end, _ownScratch);
+		}
+
+		void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
+			const size_t n = end - begin;
+			check_index_range<Index>(n);
+			const KeyOf keyOf;
+			_tagged.resize(n);
+			for (size_t i = 0; i < n; ++i) _tagged[i] = {keyOf(*(begin + i)), (Index) i};
+			_powersort.sort(_tagged.data(), _tagged.data() + n);
+			_bufferSize = n;
+			permute_by_index(&*begin, _tagged.data(), n, scratch.get(_bufferSize));
+		}
+
+		long long scratch_elements() const override { return _bufferSize; }
+
+		std::string name() const override {
+			return "KeyedPowerSort+minRunLen=" + std::to_string(minRunLen) +
+			       "+mergingMethod=" + to_string(mergingMethod) +
+			       "+keyBytes=" + std::to_string(sizeof(key_t)) +
+			       "+indexBytes=" + std::to_string(sizeof(Index));
+		}
+	};
+
+}
+
+#endif //MERGESORTS_KEYED_POWERSORT_H
@@ -4,6 +4,11 @@
 #define MERGESORTS_MERGING_H
 
 #include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include "merging_simd.h"
+#include "run_detection_simd.h"
 
 namespace algorithms {
 
@@ -28,6 +33,28 @@ namespace algorithms {
             return std::numeric_limits<T>::max();
     }
 
+    /**
+     * The elements that were move-constructed into [begin..end) of a buffer
+     * (which is uninitialized storage, see scratch_space);
+     * they are destroyed at the end of the scope, after the merge has moved them back.
+     */
+    template<typename Iter2>
+    class buffer_elements {
+        Iter2 _begin, _end;
+    public:
+        buffer_elements(Iter2 begin, Iter2 end) : _begin(begin), _end(end) {}
+        buffer_elements(const buffer_elements &) = delete;
+        buffer_elements &operator=(const buffer_elements &) = delete;
+        ~buffer_elements() { std::destroy(_begin, _end); }
+    };
+
+    /** constructs an element from x at position p of a buffer (uninitialized storage) */
+    template<typename Iter2, typename T>
+    void construct_in_buffer(Iter2 p, T &&x) {
+        typedef typename std::iterator_traits<Iter2>::value_type elem_t;
+        ::new (static_cast<void *>(std::addressof(*p))) elem_t(std::forward<T>(x));
+    }
+
 
 
     enum merging_methods {
@@ -36,7 +63,12 @@ namespace algorithms {
         UNSTABLE_BITONIC_MERGE_BRANCHLESS  /** @deprecated not faster */,
         COPY_SMALLER,
         COPY_BOTH,
-        COPY_BOTH_WITH_SENTINELS
+        COPY_BOTH_WITH_SENTINELS,
+        GALLOPING,
+        IN_PLACE_SYMMERGE,
+        VECTORIZED_BITONIC_MERGE,
+        COPY_BOTH_COUNTED,
+        COPY_BOTH_BIDIRECTIONAL
     };
 
     std::string to_string(merging_methods mergingMethod) {
@@ -53,12 +85,30 @@ namespace algorithms {
                 return "COPY_BOTH";
             case COPY_BOTH_WITH_SENTINELS:
                 return "COPY_BOTH_WITH_SENTINELS";
+            case GALLOPING:
+                return "GALLOPING";
+            case IN_PLACE_SYMMERGE:
+                return "IN_PLACE_SYMMERGE";
+            case VECTORIZED_BITONIC_MERGE:
+                return "VECTORIZED_BITONIC_MERGE";
+            case COPY_BOTH_COUNTED:
+                return "COPY_BOTH_COUNTED";
+            case COPY_BOTH_BIDIRECTIONAL:
+                return "COPY_BOTH_BIDIRECTIONAL";
             default:
                 assert(false);
                 __builtin_unreachable();
         }
     }
 
+    /**
+     * merging method used by default for arrays accessed through Iterator:
+     * VECTORIZED_BITONIC_MERGE for arrays of 32- and 64-bit integers, COPY_BOTH otherwise
+     */
+    template<typename Iterator>
+    constexpr merging_methods default_merging_method =
+            simd::vectorizable<Iterator>::value ? VECTORIZED_BITONIC_MERGE : COPY_BOTH;
+
 	/**
 	 * Merges runs [l..m) and [m..r) in-place into [l..r)
 	 * based on Sedgewick's bitonic merge (Program 8.2 in Algorithms in C++)
@@ -71,12 +121,13 @@ namespace algorithms {
 	template<typename Iter, typename Iter2>
 	void merge_runs_bitonic(Iter l, Iter m, Iter r, Iter2 B) {
 		if (COUNT_MERGE_COSTS) totalMergeCosts += (r-l);
-		std::copy_backward(l,m,B+(m-l));
-        std::reverse_copy(m,r,B+(m-l));
+		std::uninitialized_move(l,m,B);
+        std::uninitialized_move(std::make_reverse_iterator(r), std::make_reverse_iterator(m), B+(m-l));
+        const buffer_elements inBuffer(B, B+(r-l));
         if (COUNT_MERGE_COSTS) totalBufferCosts += (r-l);
         auto i = B, j = B+(r-l-1);
 		for (auto k = l; k < r; ++k)
-			*k = *j < *i ? *j-- : *i++;
+			*k = std::move(*j < *i ? *j-- : *i++);
 	}
 
 	/**
@@ -91,12 +142,13 @@ namespace algorithms {
 	void merge_runs_bitonic_manual_copy(Iter l, Iter m, Iter r, Iter2 B) {
 		Iter i1, j1; Iter2 b;
 		if (COUNT_MERGE_COSTS) totalMergeCosts += (r-l);
-		for (i1 = m-1, b = B+(m-1-l); i1 >= l;) *b-- = *i1--;
-		for (j1 = r, b = B+(m-l); j1 > m;) *b++ = *--j1;
+		for (i1 = m-1, b = B+(m-1-l); i1 >= l;) construct_in_buffer(b--, std::move(*i1--));
+		for (j1 = r, b = B+(m-l); j1 > m;) construct_in_buffer(b++, std::move(*--j1));
+		const buffer_elements inBuffer(B, B+(r-l));
         if (COUNT_MERGE_COSTS) totalBufferCosts += (r-l);
 		auto i = B, j = B+(r-l-1);
 		for (auto k = l; k < r; ++k)
-			*k = *j < *i ? *j-- : *i++;
+			*k = std::move(*j < *i ? *j-- : *i++);
 	}
 
 	/**
@@ -112,13 +164,14 @@ namespace algorithms {
 	template<typename Iter, typename Iter2>
 	void merge_runs_bitonic_branchless(Iter l, Iter m, Iter r, Iter2 B) {
 		if (COUNT_MERGE_COSTS) totalMergeCosts += (r-l);
-		std::copy_backward(l,m,B+(m-l));
-		std::reverse_copy(m,r,B+(m-l));
+		std::uninitialized_move(l,m,B);
+		std::uninitialized_move(std::make_reverse_iterator(r), std::make_reverse_iterator(m), B+(m-l));
+		const buffer_elements inBuffer(B, B+(r-l));
         if (COUNT_MERGE_COSTS) totalBufferCosts += (r-l);
 		Iter2 i = B, j = B+(r-l-1);
 		for (auto k = l; k < r; ++k) {
 			bool const cmp = *j < *i;
-			*k = cmp ? *j : *i;
+			*k = std::move(cmp ? *j : *i);
 			j -= cmp ? 1 : 0;
 			i += cmp ? 0 : 1;
 		}
@@ -135,24 +188,260 @@ namespace algorithms {
 		auto n1 = m-l, n2 = r-m;
 		if (COUNT_MERGE_COSTS) totalMergeCosts += (n1+n2);
         if (n1 <= n2) {
-            std::copy(l,m,B);
+            std::uninitialized_move(l,m,B);
+            const buffer_elements inBuffer(B, B + n1);
             if (COUNT_MERGE_COSTS) totalBufferCosts += (m-l);
             auto c1 = B, e1 = B + n1;
             auto c2 = m, e2 = r, o = l;
             while (c1 < e1 && c2 < e2)
-                *o++ = *c1 <= *c2 ? *c1++ : *c2++;
-            while (c1 < e1) *o++ = *c1++;
+                *o++ = std::move(*c1 <= *c2 ? *c1++ : *c2++);
+            while (c1 < e1) *o++ = std::move(*c1++);
         } else {
-            std::copy(m,r,B);
+            std::uninitialized_move(m,r,B);
+            const buffer_elements inBuffer(B, B + n2);
             if (COUNT_MERGE_COSTS) totalBufferCosts += (r-m);
             auto c1 = m-1, s1 = l, o = r-1;
             auto c2 = B+n2-1, s2 = B;
             while (c1 >= s1 && c2 >= s2)
-                *o-- = *c1 <= *c2 ? *c2-- : *c1--;
-            while (c2 >= s2) *o-- = *c2--;
+                *o-- = std::move(*c1 <= *c2 ? *c2-- : *c1--);
+            while (c2 >= s2) *o-- = std::move(*c2--);
         }
 	}
 
+	/**
+	 * Returns the first element in sorted [first,last) that is larger than key,
+	 * using exponential search from first followed by binary search.
+	 * Needs O(log k) comparisons when the result is first+k.
+	 */
+	template<typename T, typename Iter>
+	Iter gallop_upper_bound(const T &key, Iter first, Iter last) {
+		auto n = last - first;
+		decltype(n) lo = 0, hi = 1; // invariant: [first, first+lo) <= key
+		while (hi <= n && !(key < *(first + (hi - 1)))) { lo = hi; hi = 2 * hi + 1; }
+		return std::upper_bound(first + lo, first + std::min(hi, n), key);
+	}
+
+	/** as gallop_upper_bound, but returns the first element not smaller than key */
+	template<typename T, typename Iter>
+	Iter gallop_lower_bound(const T &key, Iter first, Iter last) {
+		auto n = last - first;
+		decltype(n) lo = 0, hi = 1; // invariant: [first, first+lo) < key
+		while (hi <= n && *(first + (hi - 1)) < key) { lo = hi; hi = 2 * hi + 1; }
+		return std::lower_bound(first + lo, first + std::min(hi, n), key);
+	}
+
+	/** as gallop_upper_bound, but with exponential search from last */
+	template<typename T, typename Iter>
+	Iter gallop_upper_bound_from_right(const T &key, Iter first, Iter last) {
+		auto n = last - first;
+		decltype(n) lo = 0, hi = 1; // invariant: [last-lo, last) > key
+		while (hi <= n && key < *(last - hi)) { lo = hi; hi = 2 * hi + 1; }
+		return std::upper_bound(last - std::min(hi, n), last - lo, key);
+	}
+
+	/** as gallop_lower_bound, but with exponential search from last */
+	template<typename T, typename Iter>
+	Iter gallop_lower_bound_from_right(const T &key, Iter first, Iter last) {
+		auto n = last - first;
+		decltype(n) lo = 0, hi = 1; // invariant: [last-lo, last) >= key
+		while (hi <= n && !(*(last - hi) < key)) { lo = hi; hi = 2 * hi + 1; }
+		return std::lower_bound(last - std::min(hi, n), last - lo, key);
+	}
+
+	/**
+	 * For merging the non-empty runs [c[i]..e[i]), 0 <= i < k, where runs further left win ties:
+	 * returns the run that is exhausted first (the leftmost one with the smallest last element)
+	 * and sets m to the number of elements output up to and including its last element
+	 * (found by galloping for that element in the other runs).
+	 * So the first m steps of the merge cannot run out of any run, just as with sentinels.
+	 */
+	template<typename Iter2>
+	unsigned first_exhausted_run(const Iter2 *c, const Iter2 *e, unsigned k, size_t &m) {
+		unsigned f = 0;
+		for (unsigned i = 1; i < k; ++i)
+			if (*(e[i] - 1) < *(e[f] - 1)) f = i;
+		const auto &last = *(e[f] - 1);
+		m = e[f] - c[f];
+		for (unsigned i = 0; i < f; ++i) m += gallop_upper_bound(last, c[i], e[i]) - c[i];
+		for (unsigned i = f + 1; i < k; ++i) m += gallop_lower_bound(last, c[i], e[i]) - c[i];
+		return f;
+	}
+
+	/** initial number of consecutive wins of one run before switching to galloping (as in Timsort) */
+	const int MIN_GALLOP = 7;
+
+	/**
+	 * Merges runs A[l..m) and A[m..r) in-place into A[l..r)
+	 * by copying the shorter run into temporary storage B and
+	 * merging back into A, like merge_runs_copy_half.
+	 * As in Timsort's mergeLo/mergeHi, once one run wins minGallop times in a row,
+	 * we switch to galloping mode, where we find the number of elements to take
+	 * from each run by exponential search and copy them in bulk.
+	 * minGallop adapts as in Timsort: it decreases while galloping pays off
+	 * and increases when we leave galloping mode. It is passed by reference so that
+	 * a sorter can keep it across all merges of a sort (initialized to MIN_GALLOP).
+	 * B must have space at least min(m-l,r-m).
+	 */
+	template<typename Iter, typename Iter2>
+	void merge_runs_galloping(Iter l, Iter m, Iter r, Iter2 B, int &minGallop) {
+		auto n1 = m-l, n2 = r-m;
+		if (COUNT_MERGE_COSTS) totalMergeCosts += (n1+n2);
+		if (n1 <= n2) {
+			std::uninitialized_move(l,m,B);
+			const buffer_elements inBuffer(B, B + n1);
+			if (COUNT_MERGE_COSTS) totalBufferCosts += n1;
+			auto c1 = B, e1 = B + n1;
+			auto c2 = m, e2 = r, o = l;
+			while (c1 < e1 && c2 < e2) {
+				decltype(n1) count1 = 0, count2 = 0; // consecutive wins
+				while (c1 < e1 && c2 < e2) {
+					if (*c2 < *c1) {
+						*o++ = std::move(*c2++); ++count2; count1 = 0;
+						if (count2 >= minGallop) break;
+					} else {
+						*o++ = std::move(*c1++); ++count1; count2 = 0;
+						if (count1 >= minGallop) break;
+					}
+				}
+				if (c1 == e1 || c2 == e2) break;
+				do { // galloping mode
+					auto k1 = gallop_upper_bound(*c2, c1, e1);
+					count1 = k1 - c1;
+					o = std::move(c1, k1, o); c1 = k1;
+					if (c1 == e1) break;
+					*o++ = std::move(*c2++);
+					if (c2 == e2) break;
+					auto k2 = gallop_lower_bound(*c1, c2, e2);
+					count2 = k2 - c2;
+					o = std::move(c2, k2, o); c2 = k2;
+					if (c2 == e2) break;
+					*o++ = std::move(*c1++);
+					if (c1 == e1) break;
+					if (minGallop > 1) --minGallop;
+				} while (count1 >= MIN_GALLOP || count2 >= MIN_GALLOP);
+				minGallop += 2; // penalize leaving galloping mode
+			}
+			std::move(c1, e1, o);
+		} else {
+			std::uninitialized_move(m,r,B);
+			const buffer_elements inBuffer(B, B + n2);
+			if (COUNT_MERGE_COSTS) totalBufferCosts += n2;
+			auto s1 = l, e1 = m;
+			auto s2 = B, e2 = B + n2, o = r;
+			while (s1 < e1 && s2 < e2) {
+				decltype(n1) count1 = 0, count2 = 0; // consecutive wins
+				while (s1 < e1 && s2 < e2) {
+					if (*(e2-1) < *(e1-1)) {
+						*--o = std::move(*--e1); ++count1; count2 = 0;
+						if (count1 >= minGallop) break;
+					} else {
+						*--o = std::move(*--e2); ++count2; count1 = 0;
+						if (count2 >= minGallop) break;
+					}
+				}
+				if (s1 == e1 || s2 == e2) break;
+				do { // galloping mode
+					auto k1 = gallop_upper_bound_from_right(*(e2-1), s1, e1);
+					count1 = e1 - k1;
+					o = std::move_backward(k1, e1, o); e1 = k1;
+					if (s1 == e1) break;
+					*--o = std::move(*--e2);
+					if (s2 == e2) break;
+					auto k2 = gallop_lower_bound_from_right(*(e1-1), s2, e2);
+					count2 = e2 - k2;
+					o = std::move_backward(k2, e2, o); e2 = k2;
+					if (s2 == e2) break;
+					*--o = std::move(*--e1);
+					if (s1 == e1) break;
+					if (minGallop > 1) --minGallop;
+				} while (count1 >= MIN_GALLOP || count2 >= MIN_GALLOP);
+				minGallop += 2; // penalize leaving galloping mode
+			}
+			std::move_backward(s2, e2, o);
+		}
+	}
+
+	/** merge_runs_galloping with minGallop starting at MIN_GALLOP for this merge */
+	template<typename Iter, typename Iter2>
+	void merge_runs_galloping(Iter l, Iter m, Iter r, Iter2 B) {
+		int minGallop = MIN_GALLOP;
+		merge_runs_galloping(l, m, r, B, minGallop);
+	}
+
+	/**
+	 * Merges runs A[l..m) and A[m..r) in-place into A[l..r)
+	 * using a buffer B with space for only bufferSize elements.
+	 * If the shorter run fits into B, this is merge_runs_copy_half;
+	 * otherwise, we split the longer run in the middle, find the matching split point
+	 * in the other run by binary search, rotate the middle parts in place
+	 * and merge the two halves recursively (as in std::inplace_merge without buffer).
+	 */
+	template<typename Iter, typename Iter2>
+	void merge_runs_bounded_buffer(Iter l, Iter m, Iter r, Iter2 B, size_t bufferSize) {
+		auto n1 = m-l, n2 = r-m;
+		if (n1 == 0 || n2 == 0) return;
+		if ((size_t) std::min(n1, n2) <= bufferSize)
+			return merge_runs_copy_half(l, m, r, B);
+		if (n1 + n2 == 2) {
+			if (*m < *l) std::iter_swap(l, m);
+			return;
+		}
+		Iter cut1, cut2;
+		if (n1 > n2) {
+			cut1 = l + n1 / 2;
+			cut2 = std::lower_bound(m, r, *cut1);
+		} else {
+			cut2 = m + n2 / 2;
+			cut1 = std::upper_bound(l, m, *cut2);
+		}
+		Iter newMid = std::rotate(cut1, m, cut2);
+		merge_runs_bounded_buffer(l, cut1, newMid, B, bufferSize);
+		merge_runs_bounded_buffer(newMid, cut2, r, B, bufferSize);
+	}
+
+	/** recursive part of merge_runs_symmerge; merges [a..m) and [m..b), given as offsets from base */
+	template<typename Iter, typename Diff>
+	void symmerge(Iter base, Diff a, Diff m, Diff b) {
+		if (m - a == 1) { // insert single left element into right run
+			Iter i = std::lower_bound(base + m, base + b, *(base + a));
+			std::rotate(base + a, base + (a + 1), i);
+			return;
+		}
+		if (b - m == 1) { // insert single right element into left run
+			Iter i = std::upper_bound(base + a, base + m, *(base + m));
+			std::rotate(i, base + m, base + b);
+			return;
+		}
+		const Diff mid = a + (b - a) / 2, n = mid + m;
+		Diff start, end;
+		if (m > mid) { start = n - b; end = mid; }
+		else { start = a; end = m; }
+		const Diff p = n - 1;
+		while (start < end) { // find symmetric split point
+			Diff c = start + (end - start) / 2;
+			if (!(*(base + (p - c)) < *(base + c))) start = c + 1;
+			else end = c;
+		}
+		end = n - start;
+		if (start < m && m < end) std::rotate(base + start, base + m, base + end);
+		if (a < start && start < mid) symmerge(base, a, start, mid);
+		if (mid < end && end < b) symmerge(base, mid, end, b);
+	}
+
+	/**
+	 * Merges runs A[l..m) and A[m..r) in-place into A[l..r) without any buffer,
+	 * using the SymMerge algorithm of Kim and Kutzner (ESA 2004):
+	 * a symmetric binary search finds split points in both runs such that
+	 * rotating the middle part leaves two independent smaller merge problems.
+	 * Needs O(n log n) element moves, O(log n) comparisons per element and O(log n) stack.
+	 */
+	template<typename Iter>
+	void merge_runs_symmerge(Iter l, Iter m, Iter r) {
+		if (COUNT_MERGE_COSTS) totalMergeCosts += (r-l);
+		if (l == m || m == r) return;
+		symmerge(l, decltype(r-l) {0}, m - l, r - l);
+	}
+
 	/**
 	 * Merges runs A[l..m) and A[m..r) in-place into A[l..r)
 	 * by copying both to buffer B and merging back into A.
@@ -162,14 +451,15 @@ namespace algorithms {
 	void merge_runs_basic(Iter l, Iter m, Iter r, Iter2 B) {
 		auto n1 = m-l, n2 = r-m;
 		if (COUNT_MERGE_COSTS) totalMergeCosts += (n1+n2);
-        std::copy(l,r,B);
+        std::uninitialized_move(l,r,B);
+        const buffer_elements inBuffer(B, B + (n1+n2));
         if (COUNT_MERGE_COSTS) totalBufferCosts += (n1+n2);
         auto c1 = B, e1 = B + n1, c2 = e1, e2 = e1 + n2;
         auto o = l;
         while (c1 < e1 && c2 < e2)
-            *o++ = *c1 <= *c2 ? *c1++ : *c2++;
-        while (c1 < e1) *o++ = *c1++;
-        while (c2 < e2) *o++ = *c2++;
+            *o++ = std::move(*c1 <= *c2 ? *c1++ : *c2++);
+        while (c1 < e1) *o++ = std::move(*c1++);
+        while (c2 < e2) *o++ = std::move(*c2++);
 	}
 
 	/**
@@ -183,16 +473,103 @@ namespace algorithms {
         static_assert(std::numeric_limits<T>::is_specialized, "Needs numeric type (for sentinels)");
         auto n1 = m-l, n2 = r-m;
 		if (COUNT_MERGE_COSTS) totalMergeCosts += (n1+n2);
-        std::copy(l, m, B);
-        *(B + (m - l)) = plus_inf_sentinel<T>();
-        std::copy(m, r, B + (m - l + 1));
-        *(B + (r - l) + 1) = plus_inf_sentinel<T>();
+        std::uninitialized_move(l, m, B);
+        construct_in_buffer(B + (m - l), plus_inf_sentinel<T>());
+        std::uninitialized_move(m, r, B + (m - l + 1));
+        construct_in_buffer(B + (r - l) + 1, plus_inf_sentinel<T>());
+        const buffer_elements inBuffer(B, B + (r - l) + 2);
         if (COUNT_MERGE_COSTS) totalBufferCosts += (n1+n2+2);
         auto c1 = B, c2 = B + (m - l + 1), o = l;
-        while (o < r) *o++ = *c1 <= *c2 ? *c1++ : *c2++;
+        while (o < r) *o++ = std::move(*c1 <= *c2 ? *c1++ : *c2++);
 	}
 
+	/**
+	 * Merges runs A[l..m) and A[m..r) in-place into A[l..r)
+	 * by copying both to buffer B and merging back into A.
+	 * Instead of sentinels, the number of steps until the first run is exhausted is computed
+	 * up front (see first_exhausted_run), so the main loop has no bounds checks as
+	 * in merge_runs_basic_sentinels, but works for any type.
+	 * B must have space at least r-l.
+	 */
+	template<typename Iter, typename Iter2>
+	void merge_runs_basic_counted(Iter l, Iter m, Iter r, Iter2 B) {
+		auto n1 = m-l, n2 = r-m;
+		if (n1 == 0 || n2 == 0) return;
+		if (COUNT_MERGE_COSTS) totalMergeCosts += (n1+n2);
+		std::uninitialized_move(l, r, B);
+		const buffer_elements inBuffer(B, B + (n1+n2));
+		if (COUNT_MERGE_COSTS) totalBufferCosts += (n1+n2);
+		const Iter2 c[] = {B, B + n1}, e[] = {B + n1, B + (n1 + n2)};
+		size_t steps;
+		const unsigned f = first_exhausted_run(c, e, 2, steps);
+		auto c1 = c[0], c2 = c[1];
+		auto o = l;
+		const Iter firstExhausted = l + steps;
+		while (o < firstExhausted) *o++ = std::move(*c1 <= *c2 ? *c1++ : *c2++);
+		if (f == 0) std::move(c2, e[1], o);
+		else std::move(c1, e[0], o);
+	}
 
+	/**
+	 * Merges runs A[l..m) and A[m..r) in-place into A[l..r)
+	 * by copying both to buffer B and merging back into A from both ends at once:
+	 * the smallest remaining element goes to the front (the left run wins ties),
+	 * the largest remaining one to the back (the right run wins ties), so the merge is stable
+	 * and the two dependency chains of comparisons can run in parallel.
+	 * The loop runs in phases of k = min(remaining lengths) / 2 steps at each end;
+	 * within a phase, neither end can exhaust a run or meet the other end, so it needs
+	 * no bounds checks. The middle that is left is merged by the loop of merge_runs_basic.
+	 * B must have space at least r-l.
+	 */
+	template<typename Iter, typename Iter2>
+	void merge_runs_bidirectional(Iter l, Iter m, Iter r, Iter2 B) {
+		auto n1 = m-l, n2 = r-m;
+		if (COUNT_MERGE_COSTS) totalMergeCosts += (n1+n2);
+		std::uninitialized_move(l, r, B);
+		const buffer_elements inBuffer(B, B + (n1+n2));
+		if (COUNT_MERGE_COSTS) totalBufferCosts += (n1+n2);
+		auto c1 = B, e1 = B + n1, c2 = e1, e2 = e1 + n2; // remaining runs [c1..e1) and [c2..e2)
+		auto o = l, q = r;                              // output goes to [l..o) and [q..r)
+		for (auto k = std::min(n1, n2) / 2; k > 0; k = std::min(e1 - c1, e2 - c2) / 2) {
+			for (; k > 0; --k) {
+				// select by conditional moves, not branches, so the two chains can overlap
+				const bool front2 = *c2 < *c1, back1 = *(e2 - 1) < *(e1 - 1);
+				*o++ = std::move(front2 ? *c2 : *c1);
+				*--q = std::move(back1 ? *(e1 - 1) : *(e2 - 1));
+				c2 += front2, c1 += !front2;
+				e1 -= back1, e2 -= !back1;
+			}
+		}
+		while (c1 < e1 && c2 < e2)
+			*o++ = std::move(*c1 <= *c2 ? *c1++ : *c2++);
+		while (c1 < e1) *o++ = std::move(*c1++);
+		while (c2 < e2) *o++ = std::move(*c2++);
+	}
+
+	/**
+	 * Merges runs A[l..m) and A[m..r) in-place into A[l..r)
+	 * by copying both to buffer B and merging back into A with a bitonic merge network
+	 * on AVX2 registers (see merging_simd.h).
+	 * This requires arrays of 32- or 64-bit integers (where the merge is effectively stable),
+	 * a CPU with AVX2 and runs that fill at least one register;
+	 * otherwise, we fall back to merge_runs_basic.
+	 * B must have space at least r-l.
+	 */
+	template<typename Iter, typename Iter2>
+	void merge_runs_vectorized(Iter l, Iter m, Iter r, Iter2 B) {
+		if constexpr (simd::vectorizable<Iter>::value && std::is_same<Iter, Iter2>::value) {
+			auto n1 = m-l, n2 = r-m;
+			typedef typename std::iterator_traits<Iter>::value_type T;
+			if (simd::can_merge_bitonic<T>(n1, n2)) {
+				if (COUNT_MERGE_COSTS) totalMergeCosts += (n1+n2);
+				std::uninitialized_copy(l, r, B);
+				if (COUNT_MERGE_COSTS) totalBufferCosts += (n1+n2);
+				simd::merge_bitonic(B, B + n1, B + n1, B + (n1 + n2), l);
+				return;
+			}
+		}
+		merge_runs_basic(l, m, r, B);
+	}
 
 #ifdef USE_OLD_RUN_DETECTION_LOOPS_WITH_IF_IN_BODY
 /** returns maximal i <= end s.t. [begin,i) is weakly increasing */
@@ -229,9 +606,14 @@ namespace algorithms {
 		return end - 1;
 	}
 #else
-	/** returns maximal i <= end s.t. [begin,i) is weakly increasing */
+	/**
+	 * returns maximal i <= end s.t. [begin,i) is weakly increasing;
+	 * vectorized for arrays of 32- and 64-bit integers (see run_detection_simd.h)
+	 */
 	template<typename Iterator>
 	Iterator weaklyIncreasingPrefix(Iterator begin, Iterator end) {
+		if constexpr (simd::vectorizable<Iterator>::value)
+			return simd::monotone_prefix<false>(begin, end);
 		while (begin + 1 < end && *begin <= *(begin + 1)) ++begin;
 		return begin + 1;
 	}
@@ -245,6 +627,8 @@ namespace algorithms {
 
 	template<typename Iterator>
 	Iterator strictlyDecreasingPrefix(Iterator begin, Iterator end) {
+		if constexpr (simd::vectorizable<Iterator>::value)
+			return simd::monotone_prefix<true>(begin, end);
 		while (begin + 1 < end &&  *begin > *(begin + 1)) ++begin;
 		return begin + 1;
 	}
@@ -271,10 +655,65 @@ namespace algorithms {
 	}
 
 
-    /** Merges runs [l..m) and [m..r) in-place into [l..r) */
-    template<merging_methods mergingMethod,
+    /**
+     * Trims runs [b[0]..b[1]), ..., [b[k-1]..b[k]) before a k-way merge (as Timsort's mergeAt):
+     * the prefix of the first run that is <= all other runs' heads and
+     * the suffix of the last run that is >= all other runs' tails are already in their final place,
+     * so b[0] and b[k] are moved inwards past them (using galloping search).
+     * Empty runs are ignored.
+     */
+    template<typename Iter, size_t nBoundaries>
+    void trim_runs(Iter (&b)[nBoundaries]) {
+        const size_t k = nBoundaries - 1, NONE = k;
+        size_t minHead = NONE; // index of run with smallest head among runs 1..k-1
+        for (size_t i = 1; i < k; ++i)
+            if (b[i] < b[i+1] && (minHead == NONE || *b[i] < *b[minHead])) minHead = i;
+        if (minHead != NONE && b[0] < b[1]) b[0] = gallop_upper_bound(*b[minHead], b[0], b[1]);
+        size_t maxTail = NONE; // index of run with largest tail among runs 0..k-2
+        for (size_t i = 0; i + 1 < k; ++i)
+            if (b[i] < b[i+1] && (maxTail == NONE || *(b[maxTail+1]-1) < *(b[i+1]-1))) maxTail = i;
+        if (maxTail != NONE && b[k-1] < b[k]) b[k] = gallop_lower_bound_from_right(*(b[maxTail+1]-1), b[k-1], b[k]);
+    }
+
+    /** false for merging methods that work entirely in place */
+    bool uses_buffer(merging_methods mergingMethod) {
+        return mergingMethod != IN_PLACE_SYMMERGE;
+    }
+
+    /** number of buffer elements merge_runs<mergingMethod> needs to merge runs of lengths n1 and n2 */
+    template<merging_methods mergingMethod>
+    size_t merge_runs_buffer_size(size_t n1, size_t n2) {
+        switch (mergingMethod) {
+            case COPY_SMALLER:
+            case GALLOPING:
+                return std::min(n1, n2);
+            case COPY_BOTH_WITH_SENTINELS:
+                return n1 + n2 + 2;
+            case IN_PLACE_SYMMERGE:
+                return 0;
+            default:
+                return n1 + n2;
+        }
+    }
+
+    /**
+     * Merges runs [l..m) and [m..r) in-place into [l..r).
+     * Elements are moved, not copied, into the buffer and back;
+     * the buffer is uninitialized storage and holds no elements afterwards (see buffer_elements).
+     * If trim is true, elements already in their final position are first excluded
+     * (see trim_runs), so that the merge and buffer costs are only paid for the rest.
+     * minGallop is the galloping threshold for GALLOPING, which the merge adapts
+     * (see merge_runs_galloping); other methods ignore it.
+     */
+    template<merging_methods mergingMethod, bool trim = false,
             typename Iter, typename Iter2>
-    void merge_runs(Iter l, Iter m, Iter r, Iter2 B) {
+    void merge_runs(Iter l, Iter m, Iter r, Iter2 B, int &minGallop) {
+        if (trim) {
+            Iter b[] = {l, m, r};
+            trim_runs(b);
+            l = b[0], r = b[2];
+            if (l == m || m == r) return;
+        }
         switch(mergingMethod) {
             case UNSTABLE_BITONIC_MERGE:
                 return merge_runs_bitonic(l, m, r, B);
@@ -287,13 +726,35 @@ namespace algorithms {
             case COPY_BOTH:
                 return merge_runs_basic(l, m, r, B);
             case COPY_BOTH_WITH_SENTINELS:
-                return merge_runs_basic_sentinels(l, m, r, B);
+                // only instantiated for types with sentinels, so that other methods work for all types
+                if constexpr (std::numeric_limits<typename std::iterator_traits<Iter>::value_type>::is_specialized)
+                    return merge_runs_basic_sentinels(l, m, r, B);
+                else
+                    static_assert(mergingMethod != COPY_BOTH_WITH_SENTINELS, "Needs numeric type (for sentinels)");
+            case GALLOPING:
+                return merge_runs_galloping(l, m, r, B, minGallop);
+            case IN_PLACE_SYMMERGE:
+                return merge_runs_symmerge(l, m, r);
+            case VECTORIZED_BITONIC_MERGE:
+                return merge_runs_vectorized(l, m, r, B);
+            case COPY_BOTH_COUNTED:
+                return merge_runs_basic_counted(l, m, r, B);
+            case COPY_BOTH_BIDIRECTIONAL:
+                return merge_runs_bidirectional(l, m, r, B);
             default:
                 assert(false);
                 __builtin_unreachable();
         }
     }
 
+    /** merge_runs with a galloping threshold that starts at MIN_GALLOP for this merge */
+    template<merging_methods mergingMethod, bool trim = false,
+            typename Iter, typename Iter2>
+    void merge_runs(Iter l, Iter m, Iter r, Iter2 B) {
+        int minGallop = MIN_GALLOP;
+        merge_runs<mergingMethod, trim>(l, m, r, B, minGallop);
+    }
+
 
 
 }
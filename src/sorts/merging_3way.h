@@ -26,15 +26,16 @@ namespace algorithms {
         assert(l <= g1 && g1 <= g2 && g2 <= r);
         typedef typename std::iterator_traits<Iter>::value_type T;
         static_assert(std::numeric_limits<T>::is_specialized, "Needs numeric type (for sentinels)");
-        const int n = r - l;
+        const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B and append a sentinel value after each.
-        std::copy(l, g1, B);
-        *(B + (g1 - l)) = plus_inf_sentinel<T>();
-        std::copy(g1, g2, B + (g1 - l) + 1);
-        *(B + (g2 - l) + 1) = plus_inf_sentinel<T>();
-        std::copy(g2, r, B + (g2 - l) + 2);
-        *(B + (r - l) + 2) = plus_inf_sentinel<T>();
+        std::uninitialized_move(l, g1, B);
+        construct_in_buffer(B + (g1 - l), plus_inf_sentinel<T>());
+        std::uninitialized_move(g1, g2, B + (g1 - l) + 1);
+        construct_in_buffer(B + (g2 - l) + 1, plus_inf_sentinel<T>());
+        std::uninitialized_move(g2, r, B + (g2 - l) + 2);
+        construct_in_buffer(B + (r - l) + 2, plus_inf_sentinel<T>());
+        const buffer_elements inBuffer(B, B + (r - l) + 3);
         if (COUNT_MERGE_COSTS) totalBufferCosts += n+3;
         // initialize pointers to runs in B.
         Iter2 c[3];
@@ -51,7 +52,7 @@ namespace algorithms {
         y = { c[2]++, false };
         if (*(x.first) <= *(y.first)) z = x; else z = y;
         // vacate root into output
-        *l++ = *(z.first);
+        *l++ = std::move(*(z.first));
         for (auto i = 1; i < n; ++i) {
             if (z.second) { // min came from c[0] or c[1], so recompute x.
                 if (*c[0] <= *c[1]) x = {c[0]++, true}; else x = {c[1]++, true};
@@ -60,7 +61,7 @@ namespace algorithms {
             }
             // always recompute z
             if (*(x.first) <= *(y.first)) z = x; else z = y;
-            *l++ = *(z.first);
+            *l++ = std::move(*(z.first));
         }
     }
 
@@ -79,15 +80,16 @@ namespace algorithms {
     void merge_3runs_numeric_willem_tuned(Iter l, Iter g1, Iter g2, Iter r, Iter2 B) {
         typedef typename std::iterator_traits<Iter>::value_type T;
         static_assert(std::numeric_limits<T>::is_specialized, "Needs numeric type (for sentinels)");
-        const int n = r - l;
+        const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B and append a sentinel value after each.
-        std::copy(l, g1, B);
-        *(B + (g1 - l)) = plus_inf_sentinel<T>();
-        std::copy(g1, g2, B + (g1 - l) + 1);
-        *(B + (g2 - l) + 1) = plus_inf_sentinel<T>();
-        std::copy(g2, r, B + (g2 - l) + 2);
-        *(B + (r - l) + 2) = plus_inf_sentinel<T>();
+        std::uninitialized_move(l, g1, B);
+        construct_in_buffer(B + (g1 - l), plus_inf_sentinel<T>());
+        std::uninitialized_move(g1, g2, B + (g1 - l) + 1);
+        construct_in_buffer(B + (g2 - l) + 1, plus_inf_sentinel<T>());
+        std::uninitialized_move(g2, r, B + (g2 - l) + 2);
+        construct_in_buffer(B + (r - l) + 2, plus_inf_sentinel<T>());
+        const buffer_elements inBuffer(B, B + (r - l) + 3);
         if (COUNT_MERGE_COSTS) totalBufferCosts += n+3;
 
         // initialize pointers to runs in B.
@@ -106,7 +108,7 @@ namespace algorithms {
         y = c[2]++;
         if (*x <= *y) z = {x, true}; else z = {y, false};
         // vacate root into output
-        *l++ = *(z.first);
+        *l++ = std::move(*(z.first));
         for (auto i = 1; i < n; ++i) {
             if (z.second) { // min came from c[0] or c[1], so recompute x.
                 if (*c[0] <= *c[1]) x = c[0]++; else x = c[1]++;
@@ -115,7 +117,7 @@ namespace algorithms {
             }
             // always recompute z
             if (*x <= *y) z = {x, true}; else z = {y, false};
-            *l++ = *(z.first);
+            *l++ = std::move(*(z.first));
         }
     }
 
@@ -123,10 +125,9 @@ namespace algorithms {
     namespace private_stages_split_ {
 
         template<typename Iter2, number_runs nRuns>
-        void initialize_tournament_tree3(std::vector<Iter2> &c, std::vector<Iter2> &e,
+        void initialize_tournament_tree3(Iter2 *c, Iter2 *e,
                                        std::array<tournament_tree_node<Iter2>, 3> &N) {
-            assert(nRuns == 3);
-            assert(nRuns == c.size() && nRuns == e.size());
+            static_assert(nRuns == THREE, "nRuns must be 3");
             // tourament tree:
             //      N[0]
             //    /     \
@@ -139,10 +140,9 @@ namespace algorithms {
         }
 
         template<typename Iter2, number_runs nRuns>
-        void update_tournament_tree3(std::vector<Iter2> &c, std::vector<Iter2> &e,
+        void update_tournament_tree3(Iter2 *c, Iter2 *e,
                                        std::array<tournament_tree_node<Iter2>, 3> &N) {
-            assert(nRuns == 3 );
-            assert(nRuns == c.size() && nRuns == e.size());
+            static_assert(nRuns == THREE, "nRuns must be 3");
             // tourament tree:
             //      N[0]
             //    /     \
@@ -160,31 +160,31 @@ namespace algorithms {
 
 
         template<typename Iter, typename Iter2, number_runs nRuns>
-        bool do_merge_runs3(Iter & l, Iter const r, std::vector<Iter2> &c, std::vector<Iter2> &e) {
+        bool do_merge_runs3(Iter & l, Iter const r, Iter2 *c, Iter2 *e) {
             static_assert(nRuns == TWO || nRuns == THREE,  "nRuns must be 2, 3 or 4");
-            if (nRuns == TWO) {
+            if constexpr (nRuns == TWO) {
                 // simply twoway merge
                 while (c[0] < e[0] && c[1] < e[1])
-                    *l++ = *c[0] <= *c[1] ? *c[0]++ : *c[1]++;
-                while (c[0] < e[0]) *l++ = *c[0]++;
-                while (c[1] < e[1]) *l++ = *c[1]++;
+                    *l++ = std::move(*c[0] <= *c[1] ? *c[0]++ : *c[1]++);
+                while (c[0] < e[0]) *l++ = std::move(*c[0]++);
+                while (c[1] < e[1]) *l++ = std::move(*c[1]++);
                 return true;
             } else {
                 assert(nRuns == THREE && "nRuns must be 3");
                 // use tournament tree
                 std::array<tournament_tree_node<Iter2>, 3> N;
                 initialize_tournament_tree3<Iter2, nRuns>(c, e, N);
-                std::vector<long> nn(nRuns); // run sizes
+                std::array<long, nRuns> nn; // run sizes
                 while (l < r) {
                     long safe = compute_safe<Iter2, nRuns>(c, e, nn);
                     if (safe > 0) {
                         for (; safe > 0; --safe) {
-                            *l++ = *(N[0].it); // output root
+                            *l++ = std::move(*(N[0].it)); // output root
                             update_tournament_tree3<Iter2, nRuns>(c, e, N);
                         }
                     } else {
                         // one run is exhausted; need to handle elements in the tree
-                        *l++ = *(N[0].it); // easy for the root (guaranteed min)
+                        *l++ = std::move(*(N[0].it)); // easy for the root (guaranteed min)
                         // rollback other element into its run
                         if (rollback_tournament_tree<Iter2, nRuns>(c, e, N, nn))
                             // occasionally, we rollback into an empty run and have to keep going;
@@ -213,27 +213,31 @@ namespace algorithms {
         const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B
-        std::copy(l, g1, B);
-        std::copy(g1, g2, B + (g1 - l));
-        std::copy(g2, r, B + (g2 - l));
+        std::uninitialized_move(l, g1, B);
+        std::uninitialized_move(g1, g2, B + (g1 - l));
+        std::uninitialized_move(g2, r, B + (g2 - l));
         if (COUNT_MERGE_COSTS) totalBufferCosts += n;
-        *(B+n) = *(B+n-1); // sentinel value so that accesses to endpoints don't fail
-        std::vector<Iter2> c {B, B + (g1 - l), B + (g2 - l)}; // current element
-        std::vector<Iter2> e {B + (g1 - l), B + (g2 - l), B + n}; // endpoints (for convenience)
+        if (n > 0) construct_in_buffer(B + n, *(B + n - 1)); // sentinel value so that accesses to endpoints don't fail
+        const buffer_elements inBuffer(B, B + (n > 0 ? n + 1 : 0));
+        Iter2 c[THREE] {B, B + (g1 - l), B + (g2 - l)}; // current element
+        Iter2 e[THREE] {B + (g1 - l), B + (g2 - l), B + n}; // endpoints (for convenience)
 
-        detect_and_remove_empty_runs(c, e);
-        while (l < r) {
-            switch (c.size()) {
-                case 3:
-                    if (do_merge_runs3<Iter, Iter2, THREE>(l, r, c, e)) break;
-                case 2:
-                    if (do_merge_runs3<Iter, Iter2, TWO>(l, r, c, e)) break;
-                case 1:
-                    return;
-                default:
-                    assert(false);
-                    __builtin_unreachable();
-            };
+        // each stage removes one run (and falls through to the next)
+        switch (detect_and_remove_empty_runs(c, e, THREE)) {
+            case 3:
+                if (do_merge_runs3<Iter, Iter2, THREE>(l, r, c, e)) break;
+                [[fallthrough]];
+            case 2:
+                do_merge_runs3<Iter, Iter2, TWO>(l, r, c, e);
+                break;
+            case 1:
+                std::move(c[0], e[0], l);
+                break;
+            case 0:
+                break;
+            default:
+                assert(false);
+                __builtin_unreachable();
         }
     }
 
@@ -242,6 +246,26 @@ namespace algorithms {
 
 
 
+    /**
+     * Merges runs [l..g1) and [g1..g2) and [g2..r) in-place into [l..r)
+     * using a buffer at B of length at least r-l, with the loser tree of merge_kruns.
+     */
+    template<typename Iter, typename Iter2>
+    void merge_3runs_loser_tree(Iter l, Iter g1, Iter g2, Iter r, Iter2 B) {
+        const Iter g[] = {l, g1, g2, r};
+        merge_kruns<3>(g, 3, B);
+    }
+
+    /**
+     * Merges runs [l..g1) and [g1..g2) and [g2..r) in-place into [l..r)
+     * using a buffer at B of length at least r-l, without sentinels (see merge_4runs_counted).
+     */
+    template<typename Iter, typename Iter2>
+    void merge_3runs_counted(Iter l, Iter g1, Iter g2, Iter r, Iter2 B) {
+        const Iter g[] = {l, g1, g2, r};
+        private_counted_::merge_counted<3>(g, B);
+    }
+
     /** Document which methods have custom 3way method; keep in sync with merge_3runs! */
     template<merging4way_methods mergingMethod>
     bool has_specialized_3way_merge() {
@@ -249,6 +273,8 @@ namespace algorithms {
             case merging4way_methods::WILLEM_WITH_INDICES:
             case merging4way_methods::WILLEM_TUNED:
             case merging4way_methods::GENERAL_BY_STAGES_SPLIT:
+            case merging4way_methods::LOSER_TREE:
+            case merging4way_methods::WILLEM_COUNTED:
                 return true;
             case merging4way_methods::FOR_NUMERIC_DATA:
             case merging4way_methods::GENERAL_NO_SENTINELS:
@@ -267,23 +293,54 @@ namespace algorithms {
     /**
        * Merges runs [l..g1) and [g1..g2) and [g2..r) in-place into [l..r)
        * using a buffer B.
+       * If trim is true, elements already in their final position are first excluded
+       * (see trim_runs); if the first or last run vanishes, we continue with a 2-way merge
+       * of the trimmed runs with twoWayMergingMethod.
        */
-    template<merging4way_methods mergingMethod, typename Iter, typename Iter2>
+    template<merging4way_methods mergingMethod, bool trim,
+            merging_methods twoWayMergingMethod, typename Iter, typename Iter2>
     void merge_3runs(Iter l, Iter g1, Iter g2, Iter r, Iter2 B) {
-        switch (mergingMethod) {
-            case merging4way_methods::WILLEM_WITH_INDICES:
-                merge_3runs_numeric_willem_a(l, g1, g2, r, B);
-                break;
-            case merging4way_methods::WILLEM_TUNED:
-                merge_3runs_numeric_willem_tuned(l, g1, g2, r, B);
-                break;
-            case merging4way_methods::GENERAL_BY_STAGES_SPLIT:
+        if (trim) {
+            Iter b[] = {l, g1, g2, r};
+            trim_runs(b);
+            l = b[0], r = b[3];
+            if (l == g1 && g2 == r) return;
+            if (l == g1) return merge_runs<twoWayMergingMethod>(g1, g2, r, B);
+            if (g2 == r) return merge_runs<twoWayMergingMethod>(l, g1, g2, B);
+        }
+        typedef typename std::iterator_traits<Iter>::value_type T;
+        if constexpr (!std::numeric_limits<T>::is_specialized) {
+            // only instantiate the methods that work without sentinels (see merge_4runs)
+            if (mergingMethod == merging4way_methods::GENERAL_BY_STAGES_SPLIT)
                 merge_3runs_by_stages_split(l, g1, g2, r, B);
-                break;
-            default:
-                // use 4way with empty 4th run
-                assert(!has_specialized_3way_merge<mergingMethod>());
+            else if (mergingMethod == merging4way_methods::LOSER_TREE)
+                merge_3runs_loser_tree(l, g1, g2, r, B);
+            else if (mergingMethod == merging4way_methods::WILLEM_COUNTED)
+                merge_3runs_counted(l, g1, g2, r, B);
+            else
                 merge_4runs<mergingMethod>(l, g1, g2, r, r, B);
+        } else {
+            switch (mergingMethod) {
+                case merging4way_methods::WILLEM_WITH_INDICES:
+                    merge_3runs_numeric_willem_a(l, g1, g2, r, B);
+                    break;
+                case merging4way_methods::WILLEM_TUNED:
+                    merge_3runs_numeric_willem_tuned(l, g1, g2, r, B);
+                    break;
+                case merging4way_methods::GENERAL_BY_STAGES_SPLIT:
+                    merge_3runs_by_stages_split(l, g1, g2, r, B);
+                    break;
+                case merging4way_methods::LOSER_TREE:
+                    merge_3runs_loser_tree(l, g1, g2, r, B);
+                    break;
+                case merging4way_methods::WILLEM_COUNTED:
+                    merge_3runs_counted(l, g1, g2, r, B);
+                    break;
+                default:
+                    // use 4way with empty 4th run
+                    assert(!has_specialized_3way_merge<mergingMethod>());
+                    merge_4runs<mergingMethod>(l, g1, g2, r, r, B);
+            }
         }
     }
 
@@ -0,0 +1,155 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_MERGING_KWAY_H
+#define MERGESORTS_MERGING_KWAY_H
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <type_traits>
+#include "merging.h"
+
+namespace algorithms {
+
+	/** largest number of runs merge_kruns can merge at once */
+	constexpr unsigned MAX_MERGE_ARITY = 64;
+
+	namespace loser_tree_ {
+
+		/**
+		 * whether loser tree nodes hold a copy of the key; otherwise they point to it
+		 * (e.g., for data::blob<16,long>), and every match first loads the keys through the pointers
+		 */
+		template<typename T>
+		constexpr bool cache_keys = std::is_trivially_copyable<T>::value && sizeof(T) <= 16;
+
+		/** the key of a loser tree node: the current head of a run */
+		template<typename T, bool cached = cache_keys<T>>
+		struct key {
+			T value;
+			const T &get() const { return value; }
+			void set(const T &x) { value = x; }
+		};
+
+		template<typename T>
+		struct key<T, false> {
+			const T *value;
+			const T &get() const { return *value; }
+			void set(const T &x) { value = &x; }
+		};
+
+		/**
+		 * leaf of run j in a tree with K leaves, numbered so that an in-order traversal
+		 * meets the runs from left to right (the leaves on the lowest level come first)
+		 */
+		template<unsigned K>
+		constexpr unsigned leaf(unsigned j) {
+			unsigned p = 1; // largest power of two <= 2K-1 (first node on the lowest level)
+			while (2 * p <= 2 * K - 1) p *= 2;
+			return j < 2 * K - p ? p + j : K + (j - (2 * K - p));
+		}
+
+		/**
+		 * plays the match of the winner (key w, run wRun) against the loser stored at a node
+		 * (key l, run lRun); afterwards, w and wRun are the winner, l and lRun the loser.
+		 * Ties go to the player from the left subtree, which is the stored loser if fromRight.
+		 * The players are selected by indexing instead of conditionals, so that the compiler
+		 * does not emit (unpredictable) branches.
+		 */
+		template<typename Key>
+		inline void play(Key &w, unsigned &wRun, Key &l, unsigned &lRun, bool fromRight) {
+			const Key keys[2] = {w, l};
+			const unsigned runs[2] = {wRun, lRun};
+			const bool loserWins = (keys[!fromRight].get() < keys[fromRight].get()) ^ fromRight;
+			w = keys[loserWins], l = keys[!loserWins];
+			wRun = runs[loserWins], lRun = runs[!loserWins];
+		}
+
+		/**
+		 * merges the K non-empty runs [c[i]..e[i]) to o with a loser tree:
+		 * the internal nodes 1..K-1 of an implicit tree (children of i are 2i and 2i+1,
+		 * leaves K..2K-1, see leaf) hold the loser of the match played there, so that
+		 * replacing the winner needs one comparison per level on the path from its leaf.
+		 * All runs in the left subtree of a node come before those in the right subtree,
+		 * so ties are resolved by the direction the winner comes from and the merge is stable.
+		 * When a run is exhausted, it is removed and the rest is merged by a tree for K-1 runs;
+		 * so no sentinels are needed. c and e are overwritten.
+		 */
+		template<unsigned K, typename T, typename Iter2, typename Iter>
+		Iter merge(Iter2 *c, Iter2 *e, Iter o) {
+			if constexpr (K == 1) {
+				return std::move(c[0], e[0], o);
+			} else {
+				typedef key<T> key_t;
+				key_t keys[2 * K];     // keys[i] for 1 <= i < K: loser at node i; also winners during setup
+				unsigned runs[2 * K];  // runs[i]: the run of keys[i]
+				unsigned leafOf[K];
+				for (unsigned j = 0; j < K; ++j) leafOf[j] = leaf<K>(j);
+				key_t winKeys[2 * K];
+				unsigned winRuns[2 * K];
+				for (unsigned j = 0; j < K; ++j) winKeys[leafOf[j]].set(*c[j]), winRuns[leafOf[j]] = j;
+				for (unsigned i = K - 1; i > 0; --i) {
+					// winner of node i moves up, loser stays; the left child wins ties
+					winKeys[i] = winKeys[2 * i], winRuns[i] = winRuns[2 * i];
+					keys[i] = winKeys[2 * i + 1], runs[i] = winRuns[2 * i + 1];
+					play(winKeys[i], winRuns[i], keys[i], runs[i], false);
+				}
+				key_t w = winKeys[1];
+				unsigned wRun = winRuns[1];
+				while (true) {
+					*o = std::move(*c[wRun]), ++o;
+					if (++c[wRun] == e[wRun]) {
+						for (unsigned j = wRun; j + 1 < K; ++j) c[j] = c[j + 1], e[j] = e[j + 1];
+						return merge<K - 1, T>(c, e, o);
+					}
+					w.set(*c[wRun]);
+					for (unsigned i = leafOf[wRun]; i > 1; i /= 2)
+						play(w, wRun, keys[i / 2], runs[i / 2], i & 1);
+				}
+			}
+		}
+
+		/** calls merge<k, T> for the runtime k <= maxK */
+		template<unsigned maxK, typename T, typename Iter2, typename Iter>
+		Iter merge_dispatch(Iter2 *c, Iter2 *e, unsigned k, Iter o) {
+			assert(1 <= k && k <= maxK);
+			if constexpr (maxK == 1) return merge<1, T>(c, e, o);
+			else return k == maxK ? merge<maxK, T>(c, e, o) : merge_dispatch<maxK - 1, T>(c, e, k, o);
+		}
+	}
+
+	/**
+	 * Merges the k runs [g[0]..g[1]), [g[1]..g[2]), ..., [g[k-1]..g[k]) in-place
+	 * into [g[0]..g[k]) using a buffer at B of length at least g[k]-g[0].
+	 * 2 <= k <= maxK <= MAX_MERGE_ARITY; empty runs are allowed.
+	 *
+	 * The runs are moved to B and merged back with a loser tree over the non-empty runs
+	 * (one comparison per level, i.e., ceil(lg k) per element; see loser_tree_::merge),
+	 * with keys cached in the nodes for small trivially copyable types.
+	 * Stable, needs no sentinels and allocates nothing.
+	 */
+	template<unsigned maxK = MAX_MERGE_ARITY, typename Iter, typename Iter2>
+	void merge_kruns(const Iter *g, unsigned k, Iter2 B) {
+		static_assert(maxK <= MAX_MERGE_ARITY, "at most MAX_MERGE_ARITY runs");
+		typedef typename std::iterator_traits<Iter>::value_type T;
+		assert(2 <= k && k <= maxK);
+		const Iter l = g[0];
+		const auto n = g[k] - l;
+		if (n == 0) return;
+		if (COUNT_MERGE_COSTS) totalMergeCosts += n;
+		std::uninitialized_move(l, g[k], B);
+		const buffer_elements inBuffer(B, B + n);
+		if (COUNT_MERGE_COSTS) totalBufferCosts += n;
+		Iter2 c[maxK], e[maxK]; // current element and end of non-empty runs in B
+		unsigned nRuns = 0;
+		for (unsigned i = 0; i < k; ++i)
+			if (g[i] < g[i + 1]) {
+				c[nRuns] = B + (g[i] - l);
+				e[nRuns++] = B + (g[i + 1] - l);
+			}
+		loser_tree_::merge_dispatch<maxK, T>(c, e, nRuns, l);
+	}
+
+}
+
+#endif //MERGESORTS_MERGING_KWAY_H
@@ -4,7 +4,9 @@
 #define MERGESORTS_MERGING_MULTIWAY_H
 
 #include "merging.h"
+#include "merging_kway.h"
 #include <algorithm>
+#include <array>
 #include <vector>
 #include <limits>
 #include <cassert>
@@ -30,17 +32,18 @@ namespace algorithms {
     void merge_4runs_numeric(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
         typedef typename std::iterator_traits<Iter>::value_type T;
         static_assert(std::numeric_limits<T>::is_specialized, "Needs numeric type (for sentinels)");
-        const int n = r - l;
+        const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B and append a sentinel value after each.
-        std::copy(l, g1, B);
-        *(B + (g1 - l)) = plus_inf_sentinel<T>();
-        std::copy(g1, g2, B + (g1 - l) + 1);
-        *(B + (g2 - l) + 1) = plus_inf_sentinel<T>();
-        std::copy(g2, g3, B + (g2 - l) + 2);
-        *(B + (g3 - l) + 2) = plus_inf_sentinel<T>();
-        std::copy(g3, r, B + (g3 - l) + 3);
-        *(B + (r - l) + 3) = plus_inf_sentinel<T>();
+        std::uninitialized_move(l, g1, B);
+        construct_in_buffer(B + (g1 - l), plus_inf_sentinel<T>());
+        std::uninitialized_move(g1, g2, B + (g1 - l) + 1);
+        construct_in_buffer(B + (g2 - l) + 1, plus_inf_sentinel<T>());
+        std::uninitialized_move(g2, g3, B + (g2 - l) + 2);
+        construct_in_buffer(B + (g3 - l) + 2, plus_inf_sentinel<T>());
+        std::uninitialized_move(g3, r, B + (g3 - l) + 3);
+        construct_in_buffer(B + (r - l) + 3, plus_inf_sentinel<T>());
+        const buffer_elements inBuffer(B, B + (r - l) + 4);
         if (COUNT_MERGE_COSTS) totalBufferCosts += n+4;
         // initialize pointers to runs in B.
         Iter2 c[4] = {B, B + (g1 - l) + 1, B + (g2 - l) + 2, B + (g3 - l) + 3}; // current element
@@ -56,7 +59,7 @@ namespace algorithms {
         y = *c[2] <= *c[3] ? 2 : 3;
         z = *c[x] <= *c[y] ? x : y;
         // vacate root into output
-        *l++ = *c[z]++;
+        *l++ = std::move(*c[z]++);
         for (auto i = 1; i < n; ++i) {
             if (z <= 1) { // min came from 0 or 1, so recompute x.
                 x = *c[0] <= *c[1] ? 0 : 1;
@@ -65,7 +68,7 @@ namespace algorithms {
             }
             // always recompute z
             z = *c[x] <= *c[y] ? x : y;
-            *l++ = *c[z]++;
+            *l++ = std::move(*c[z]++);
         }
     }
 
@@ -80,17 +83,18 @@ namespace algorithms {
     void merge_4runs_numeric_willem(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
         typedef typename std::iterator_traits<Iter>::value_type T;
         static_assert(std::numeric_limits<T>::is_specialized, "Needs numeric type (for sentinels)");
-        const int n = r - l;
+        const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B and append a sentinel value after each.
-        std::copy(l, g1, B);
-        *(B + (g1 - l)) = plus_inf_sentinel<T>();
-        std::copy(g1, g2, B + (g1 - l) + 1);
-        *(B + (g2 - l) + 1) = plus_inf_sentinel<T>();
-        std::copy(g2, g3, B + (g2 - l) + 2);
-        *(B + (g3 - l) + 2) = plus_inf_sentinel<T>();
-        std::copy(g3, r, B + (g3 - l) + 3);
-        *(B + (r - l) + 3) = plus_inf_sentinel<T>();
+        std::uninitialized_move(l, g1, B);
+        construct_in_buffer(B + (g1 - l), plus_inf_sentinel<T>());
+        std::uninitialized_move(g1, g2, B + (g1 - l) + 1);
+        construct_in_buffer(B + (g2 - l) + 1, plus_inf_sentinel<T>());
+        std::uninitialized_move(g2, g3, B + (g2 - l) + 2);
+        construct_in_buffer(B + (g3 - l) + 2, plus_inf_sentinel<T>());
+        std::uninitialized_move(g3, r, B + (g3 - l) + 3);
+        construct_in_buffer(B + (r - l) + 3, plus_inf_sentinel<T>());
+        const buffer_elements inBuffer(B, B + (r - l) + 4);
         if (COUNT_MERGE_COSTS) totalBufferCosts += n+4;
         // initialize pointers to runs in B.
         Iter2 a, b, c, d;
@@ -107,7 +111,7 @@ namespace algorithms {
         if (*c <= *d) y = {c++, false}; else y = {d++, false};
         if (*x.first <= *y.first) z = x; else z = y;
         // vacate root into output
-        *l++ = *(z.first);
+        *l++ = std::move(*(z.first));
         for (auto i = 1; i < n; ++i) {
             if (z.second) { // min came from a or b, so recompute x.
                 if (*a <= *b) x = {a++, true}; else x = {b++, true};
@@ -116,7 +120,7 @@ namespace algorithms {
             }
             // always recompute z
             z = *(x.first) <= *(y.first) ? x : y;
-            *l++ = *(z.first);
+            *l++ = std::move(*(z.first));
         }
     }
 
@@ -124,15 +128,16 @@ namespace algorithms {
     void wb_merge4way3(Iter l, Iter g1, Iter g2, Iter g3, Iter r, IterBuffer B) {
         typedef typename std::iterator_traits<Iter>::value_type T;
         static_assert(std::numeric_limits<T>::is_specialized, "Needs numeric type (for sentinels)");
-        std::copy(l, g1, B);
-        *(B + (g1 - l)) = plus_inf_sentinel<T>();
-        std::copy(g1, g2, B + (g1 - l) + 1);
-        *(B + (g2 - l) + 1) = plus_inf_sentinel<T>();
-        std::copy(g2, g3, B + (g2 - l) + 2);
-        *(B + (g3 - l) + 2) = plus_inf_sentinel<T>();
-        std::copy(g3, r, B + (g3 - l) + 3);
-        *(B + (r - l) + 3) = plus_inf_sentinel<T>();
-        int size = r - l;
+        std::uninitialized_move(l, g1, B);
+        construct_in_buffer(B + (g1 - l), plus_inf_sentinel<T>());
+        std::uninitialized_move(g1, g2, B + (g1 - l) + 1);
+        construct_in_buffer(B + (g2 - l) + 1, plus_inf_sentinel<T>());
+        std::uninitialized_move(g2, g3, B + (g2 - l) + 2);
+        construct_in_buffer(B + (g3 - l) + 2, plus_inf_sentinel<T>());
+        std::uninitialized_move(g3, r, B + (g3 - l) + 3);
+        construct_in_buffer(B + (r - l) + 3, plus_inf_sentinel<T>());
+        const buffer_elements inBuffer(B, B + (r - l) + 4);
+        auto size = r - l;
         IterBuffer a, b, c, d;
         a = B, b = B + (g1 - l) + 1, c = B + (g2 - l) + 2, d = B + (g3 - l) + 3;
         std::pair<T, int> x, y, z;
@@ -168,17 +173,18 @@ namespace algorithms {
     void merge_4runs_numeric_willem_a(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
         typedef typename std::iterator_traits<Iter>::value_type T;
         static_assert(std::numeric_limits<T>::is_specialized, "Needs numeric type (for sentinels)");
-        const int n = r - l;
+        const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B and append a sentinel value after each.
-        std::copy(l, g1, B);
-        *(B + (g1 - l)) = plus_inf_sentinel<T>();
-        std::copy(g1, g2, B + (g1 - l) + 1);
-        *(B + (g2 - l) + 1) = plus_inf_sentinel<T>();
-        std::copy(g2, g3, B + (g2 - l) + 2);
-        *(B + (g3 - l) + 2) = plus_inf_sentinel<T>();
-        std::copy(g3, r, B + (g3 - l) + 3);
-        *(B + (r - l) + 3) = plus_inf_sentinel<T>();
+        std::uninitialized_move(l, g1, B);
+        construct_in_buffer(B + (g1 - l), plus_inf_sentinel<T>());
+        std::uninitialized_move(g1, g2, B + (g1 - l) + 1);
+        construct_in_buffer(B + (g2 - l) + 1, plus_inf_sentinel<T>());
+        std::uninitialized_move(g2, g3, B + (g2 - l) + 2);
+        construct_in_buffer(B + (g3 - l) + 2, plus_inf_sentinel<T>());
+        std::uninitialized_move(g3, r, B + (g3 - l) + 3);
+        construct_in_buffer(B + (r - l) + 3, plus_inf_sentinel<T>());
+        const buffer_elements inBuffer(B, B + (r - l) + 4);
         if (COUNT_MERGE_COSTS) totalBufferCosts += n+4;
         // initialize pointers to runs in B.
         Iter2 c[4];
@@ -195,7 +201,7 @@ namespace algorithms {
         if (*c[2] <= *c[3]) y = {c[2]++, false}; else y = {c[3]++, false};
         if (*(x.first) <= *(y.first)) z = x; else z = y;
         // vacate root into output
-        *l++ = *(z.first);
+        *l++ = std::move(*(z.first));
         for (auto i = 1; i < n; ++i) {
             if (z.second) { // min came from c[0] or c[1], so recompute x.
                 if (*c[0] <= *c[1]) x = {c[0]++, true}; else x = {c[1]++, true};
@@ -204,7 +210,7 @@ namespace algorithms {
             }
             // always recompute z
             if (*(x.first) <= *(y.first)) z = x; else z = y;
-            *l++ = *(z.first);
+            *l++ = std::move(*(z.first));
         }
     }
 
@@ -222,17 +228,18 @@ namespace algorithms {
     void merge_4runs_numeric_willem_tuned(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
         typedef typename std::iterator_traits<Iter>::value_type T;
         static_assert(std::numeric_limits<T>::is_specialized, "Needs numeric type (for sentinels)");
-        const int n = r - l;
+        const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B and append a sentinel value after each.
-        std::copy(l, g1, B);
-        *(B + (g1 - l)) = plus_inf_sentinel<T>();
-        std::copy(g1, g2, B + (g1 - l) + 1);
-        *(B + (g2 - l) + 1) = plus_inf_sentinel<T>();
-        std::copy(g2, g3, B + (g2 - l) + 2);
-        *(B + (g3 - l) + 2) = plus_inf_sentinel<T>();
-        std::copy(g3, r, B + (g3 - l) + 3);
-        *(B + (r - l) + 3) = plus_inf_sentinel<T>();
+        std::uninitialized_move(l, g1, B);
+        construct_in_buffer(B + (g1 - l), plus_inf_sentinel<T>());
+        std::uninitialized_move(g1, g2, B + (g1 - l) + 1);
+        construct_in_buffer(B + (g2 - l) + 1, plus_inf_sentinel<T>());
+        std::uninitialized_move(g2, g3, B + (g2 - l) + 2);
+        construct_in_buffer(B + (g3 - l) + 2, plus_inf_sentinel<T>());
+        std::uninitialized_move(g3, r, B + (g3 - l) + 3);
+        construct_in_buffer(B + (r - l) + 3, plus_inf_sentinel<T>());
+        const buffer_elements inBuffer(B, B + (r - l) + 4);
         if (COUNT_MERGE_COSTS) totalBufferCosts += n+4;
         // initialize pointers to runs in B.
         Iter2 c[4];
@@ -250,7 +257,7 @@ namespace algorithms {
         if (*c[2] <= *c[3]) y = c[2]++; else y = c[3]++;
         if (*x <= *y) z = {x, true}; else z = {y, false};
         // vacate root into output
-        *l++ = *(z.first);
+        *l++ = std::move(*(z.first));
         for (auto i = 1; i < n; ++i) {
             if (z.second) { // min came from c[0] or c[1], so recompute x.
                 if (*c[0] <= *c[1]) x = c[0]++; else x = c[1]++;
@@ -259,7 +266,7 @@ namespace algorithms {
             }
             // always recompute z
             if (*x <= *y) z = {x, true}; else z = {y, false};
-            *l++ = *(z.first);
+            *l++ = std::move(*(z.first));
         }
     }
 
@@ -276,17 +283,18 @@ namespace algorithms {
     void merge_4runs_numeric_plain_min(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
         typedef typename std::iterator_traits<Iter>::value_type T;
         static_assert(std::numeric_limits<T>::is_specialized, "Needs numeric type (for sentinels)");
-        const int n = r - l;
+        const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B and append a sentinel value after each.
-        std::copy(l, g1, B);
-        *(B + (g1 - l)) = plus_inf_sentinel<T>();
-        std::copy(g1, g2, B + (g1 - l) + 1);
-        *(B + (g2 - l) + 1) = plus_inf_sentinel<T>();
-        std::copy(g2, g3, B + (g2 - l) + 2);
-        *(B + (g3 - l) + 2) = plus_inf_sentinel<T>();
-        std::copy(g3, r, B + (g3 - l) + 3);
-        *(B + (r - l) + 3) = plus_inf_sentinel<T>();
+        std::uninitialized_move(l, g1, B);
+        construct_in_buffer(B + (g1 - l), plus_inf_sentinel<T>());
+        std::uninitialized_move(g1, g2, B + (g1 - l) + 1);
+        construct_in_buffer(B + (g2 - l) + 1, plus_inf_sentinel<T>());
+        std::uninitialized_move(g2, g3, B + (g2 - l) + 2);
+        construct_in_buffer(B + (g3 - l) + 2, plus_inf_sentinel<T>());
+        std::uninitialized_move(g3, r, B + (g3 - l) + 3);
+        construct_in_buffer(B + (r - l) + 3, plus_inf_sentinel<T>());
+        const buffer_elements inBuffer(B, B + (r - l) + 4);
         if (COUNT_MERGE_COSTS) totalBufferCosts += n+4;
         // initialize pointers to runs in B.
         Iter2 c[4];
@@ -295,7 +303,7 @@ namespace algorithms {
             auto argmin01 = (*c[0] <= *c[1]) ? 0 : 1;
             auto argmin23 = (*c[2] <= *c[3]) ? 2 : 3;
             auto argmin = (*c[argmin01] <= *c[argmin23]) ? argmin01 : argmin23;
-            *l++ = *c[argmin]++;
+            *l++ = std::move(*c[argmin]++);
         }
     }
 
@@ -309,15 +317,16 @@ namespace algorithms {
     template<typename Iter, typename Iter2>
     void merge_4runs_indices(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
         typedef typename std::iterator_traits<Iter>::value_type T;
-        const int n = r - l;
+        const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B
-        std::copy(l, g1, B);
-        std::copy(g1, g2, B + (g1 - l));
-        std::copy(g2, g3, B + (g2 - l));
-        std::copy(g3, r, B + (g3 - l));
+        std::uninitialized_move(l, g1, B);
+        std::uninitialized_move(g1, g2, B + (g1 - l));
+        std::uninitialized_move(g2, g3, B + (g2 - l));
+        std::uninitialized_move(g3, r, B + (g3 - l));
         if (COUNT_MERGE_COSTS) totalBufferCosts += n;
-        *(B+n) = *B; // sentinel value so that accesses to endpoints don't fail
+        if (n > 0) construct_in_buffer(B + n, *B); // sentinel value so that accesses to endpoints don't fail
+        const buffer_elements inBuffer(B, B + (n > 0 ? n + 1 : 0));
         // initialize pointers to runs in B.
         Iter2 c[4] = {B, B + (g1 - l), B + (g2 - l), B + (g3 - l)}; // current element
         const Iter2 e[4] = {B + (g1 - l), B + (g2 - l), B + (g3 - l), B + n}; // endpoints (for convenience)
@@ -336,7 +345,7 @@ namespace algorithms {
         z = *c[x] <= *c[y] ? x : y;
         if (c[z] == e[z]) z = z <= 1 ? y : x; // if empty, use other child
         for (auto i = 0; i < n; ++i) {
-            *l++ = *c[z]++; // vacate root to output
+            *l++ = std::move(*c[z]++); // vacate root to output
             if (z <= 1) { // min came from 0 or 1, so recompute x.
                 x = *c[0] <= *c[1] ? 0 : 1;
                 if (c[x] == e[x]) x = 1-x; // if empty, use other run
@@ -367,25 +376,28 @@ namespace algorithms {
             FOUR = 4
         };
 
+        /**
+         * The runs are kept in fixed-size arrays (on the stack of the merge method):
+         * run i is [c[i]..e[i]) for 0 <= i < nRuns; nRuns <= FOUR.
+         */
         template<typename Iter2>
-        void detect_and_remove_empty_runs(std::vector<Iter2> & c, std::vector<Iter2> & e) {
-            int nRuns = c.size();
-            long safe;
-            while (true) {
-                std::vector<long> nn(nRuns);
-                for (int i = 0; i < nRuns; ++i) nn[i] = e[i] - c[i];
-                safe = *(std::min_element(nn.begin(), nn.end()));
-                if (safe > 0) return;
-                int i = std::find(nn.begin(), nn.end(), 0) - nn.begin();
-                c.erase(c.begin() + i);
-                e.erase(e.begin() + i);
-                --nRuns;
-            }
+        void remove_run(Iter2 *c, Iter2 *e, int &nRuns, int i) {
+            assert(0 <= i && i < nRuns);
+            std::move(c + i + 1, c + nRuns, c + i);
+            std::move(e + i + 1, e + nRuns, e + i);
+            --nRuns;
+        }
+
+        /** removes the empty runs and returns the number of remaining runs */
+        template<typename Iter2>
+        int detect_and_remove_empty_runs(Iter2 *c, Iter2 *e, int nRuns) {
+            for (int i = nRuns - 1; i >= 0; --i)
+                if (c[i] == e[i]) remove_run(c, e, nRuns, i);
+            return nRuns;
         }
 
         template<typename Iter2, number_runs nRuns>
-        long compute_safe(std::vector<Iter2> & c, std::vector<Iter2> & e, std::vector<long> & nn) {
-            assert(nRuns == c.size() && nRuns == e.size() && nRuns == nn.size());
+        long compute_safe(Iter2 *c, Iter2 *e, std::array<long, nRuns> & nn) {
             for (int i = 0; i < nRuns; ++i) nn[i] = e[i] - c[i];
             long safe = *(std::min_element(nn.begin(), nn.end()));
             assert (safe >= 0);
@@ -393,10 +405,9 @@ namespace algorithms {
         }
 
         template<typename Iter2, number_runs nRuns>
-        void initialize_tournament_tree(std::vector<Iter2> &c, std::vector<Iter2> &e,
+        void initialize_tournament_tree(Iter2 *c, Iter2 *e,
                                        std::array<tournament_tree_node<Iter2>, 3> &N) {
-            assert(nRuns == 3 || nRuns == 4);
-            assert(nRuns == c.size() && nRuns == e.size());
+            static_assert(nRuns == THREE || nRuns == FOUR, "nRuns must be 3 or 4");
             // tourament tree:
             //      N[0]
             //    /     \
@@ -411,10 +422,9 @@ namespace algorithms {
             N[0] = *(N[1].it) <= *(N[2].it) ? N[1] : N[2];
         }
         template<typename Iter2, number_runs nRuns>
-        void update_tournament_tree(std::vector<Iter2> &c, std::vector<Iter2> &e,
+        void update_tournament_tree(Iter2 *c, Iter2 *e,
                                        std::array<tournament_tree_node<Iter2>, 3> &N) {
-            assert(nRuns == 3 || nRuns == 4);
-            assert(nRuns == c.size() && nRuns == e.size());
+            static_assert(nRuns == THREE || nRuns == FOUR, "nRuns must be 3 or 4");
             // tourament tree:
             //      N[0]
             //    /     \
@@ -434,10 +444,9 @@ namespace algorithms {
         }
 
         template<typename Iter2, number_runs nRuns>
-        bool rollback_tournament_tree(std::vector<Iter2> &c, std::vector<Iter2> &e,
+        bool rollback_tournament_tree(Iter2 *c, Iter2 *e,
                                      std::array<tournament_tree_node<Iter2>, 3> &N,
-                                     std::vector<long> &nn) {
-            assert(nRuns == c.size() && nRuns == e.size() && nRuns == nn.size());
+                                     std::array<long, nRuns> &nn) {
             auto other = N[0].fromRun0Or1 ? N[2] : N[1];
             // roll back into 'its' run
             int rollbacks = 0;
@@ -456,38 +465,38 @@ namespace algorithms {
                 initialize_tournament_tree<Iter2, nRuns>(c, e, N);
                 return false;
             } else {
-                c.erase(c.begin() + i);
-                e.erase(e.begin() + i);
+                int n = nRuns;
+                remove_run(c, e, n, i);
                 return true;
             }
         }
 
         template<typename Iter, typename Iter2, number_runs nRuns>
-        bool do_merge_runs(Iter & l, Iter const r, std::vector<Iter2> &c, std::vector<Iter2> &e) {
+        bool do_merge_runs(Iter & l, Iter const r, Iter2 *c, Iter2 *e) {
             static_assert(nRuns == TWO || nRuns == THREE || nRuns == FOUR, "nRuns must be 2, 3 or 4");
-            if (nRuns == TWO) {
+            if constexpr (nRuns == TWO) {
                 // simple two-way merge
                 while (c[0] < e[0] && c[1] < e[1])
-                    *l++ = *c[0] <= *c[1] ? *c[0]++ : *c[1]++;
-                while (c[0] < e[0]) *l++ = *c[0]++;
-                while (c[1] < e[1]) *l++ = *c[1]++;
+                    *l++ = std::move(*c[0] <= *c[1] ? *c[0]++ : *c[1]++);
+                while (c[0] < e[0]) *l++ = std::move(*c[0]++);
+                while (c[1] < e[1]) *l++ = std::move(*c[1]++);
                 return true;
             } else {
                 assert(nRuns == THREE || nRuns == FOUR && "nRuns must be 3 or 4");
                 // use tournament tree
                 std::array<tournament_tree_node<Iter2>, 3> N;
                 initialize_tournament_tree<Iter2, nRuns>(c, e, N);
-                std::vector<long> nn(nRuns); // run sizes
+                std::array<long, nRuns> nn; // run sizes
                 while (l < r) {
                     long safe = compute_safe<Iter2, nRuns>(c, e, nn);
                     if (safe > 0) {
                         for (; safe > 0; --safe) {
-                            *l++ = *(N[0].it); // output root
+                            *l++ = std::move(*(N[0].it)); // output root
                             update_tournament_tree<Iter2, nRuns>(c, e, N);
                         }
                     } else {
                         // one run is exhausted; need to handle elements in the tree
-                        *l++ = *(N[0].it); // easy for the root (guaranteed min)
+                        *l++ = std::move(*(N[0].it)); // easy for the root (guaranteed min)
                         // rollback other element into its run
                         if (rollback_tournament_tree<Iter2, nRuns>(c, e, N, nn))
                             // occasionally, we rollback into an empty run and have to keep going;
@@ -516,30 +525,35 @@ namespace algorithms {
         const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B
-        std::copy(l, g1, B);
-        std::copy(g1, g2, B + (g1 - l));
-        std::copy(g2, g3, B + (g2 - l));
-        std::copy(g3, r, B + (g3 - l));
+        std::uninitialized_move(l, g1, B);
+        std::uninitialized_move(g1, g2, B + (g1 - l));
+        std::uninitialized_move(g2, g3, B + (g2 - l));
+        std::uninitialized_move(g3, r, B + (g3 - l));
         if (COUNT_MERGE_COSTS) totalBufferCosts += n;
-        *(B+n) = *(B+n-1); // sentinel value so that accesses to endpoints don't fail
-        std::vector<Iter2> c {B, B + (g1 - l), B + (g2 - l), B + (g3 - l)}; // current element
-        std::vector<Iter2> e {B + (g1 - l), B + (g2 - l), B + (g3 - l), B + n}; // endpoints (for convenience)
+        if (n > 0) construct_in_buffer(B + n, *(B + n - 1)); // sentinel value so that accesses to endpoints don't fail
+        const buffer_elements inBuffer(B, B + (n > 0 ? n + 1 : 0));
+        Iter2 c[FOUR] {B, B + (g1 - l), B + (g2 - l), B + (g3 - l)}; // current element
+        Iter2 e[FOUR] {B + (g1 - l), B + (g2 - l), B + (g3 - l), B + n}; // endpoints (for convenience)
 
-        detect_and_remove_empty_runs(c, e);
-        while (l < r) {
-            switch (c.size()) {
-                case 4:
-                    if (do_merge_runs<Iter, Iter2, FOUR>(l, r, c, e)) break;
-                case 3:
-                    if (do_merge_runs<Iter, Iter2, THREE>(l, r, c, e)) break;
-                case 2:
-                    if (do_merge_runs<Iter, Iter2, TWO>(l, r, c, e)) break;
-                case 1:
-                    return;
-                default:
-                    assert(false);
-                    __builtin_unreachable();
-            };
+        // each stage removes one run (and falls through to the next)
+        switch (detect_and_remove_empty_runs(c, e, FOUR)) {
+            case 4:
+                if (do_merge_runs<Iter, Iter2, FOUR>(l, r, c, e)) break;
+                [[fallthrough]];
+            case 3:
+                if (do_merge_runs<Iter, Iter2, THREE>(l, r, c, e)) break;
+                [[fallthrough]];
+            case 2:
+                do_merge_runs<Iter, Iter2, TWO>(l, r, c, e);
+                break;
+            case 1:
+                std::move(c[0], e[0], l);
+                break;
+            case 0:
+                break;
+            default:
+                assert(false);
+                __builtin_unreachable();
         }
     }
 
@@ -559,12 +573,13 @@ namespace algorithms {
         const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B
-        std::copy(l, g1, B);
-        std::copy(g1, g2, B + (g1 - l));
-        std::copy(g2, g3, B + (g2 - l));
-        std::copy(g3, r, B + (g3 - l));
+        std::uninitialized_move(l, g1, B);
+        std::uninitialized_move(g1, g2, B + (g1 - l));
+        std::uninitialized_move(g2, g3, B + (g2 - l));
+        std::uninitialized_move(g3, r, B + (g3 - l));
         if (COUNT_MERGE_COSTS) totalBufferCosts += n;
-        *(B+n) = *(B+n-1); // sentinel value so that accesses to endpoints don't fail
+        if (n > 0) construct_in_buffer(B + n, *(B + n - 1)); // sentinel value so that accesses to endpoints don't fail
+        const buffer_elements inBuffer(B, B + (n > 0 ? n + 1 : 0));
 
         long todo = n; // number of elements to output
 
@@ -610,7 +625,7 @@ namespace algorithms {
                 if (safe == 0) {
                     // one run is exhausted, so need to eliminate a run from the tree
                     // but: need to output the elements currently in the tree first
-                    *l++ = *(z.first); // easy for the root (guaranteed min)
+                    *l++ = std::move(*(z.first)); // easy for the root (guaranteed min)
                     --todo;
                     auto other = z.second ? y : x;
                     // outputting other now gets absurdly messy; instead roll back into its run
@@ -638,7 +653,7 @@ namespace algorithms {
                 } else {
                     todo -= safe;
                     for (; safe > 0; --safe) {
-                        *l++ = *(z.first);
+                        *l++ = std::move(*(z.first));
                         if (z.second) { // min came from c[0] or c[1], so recompute x.
                             x = {*c[0] <= *c[1] ? c[0]++ : c[1]++, true};
                         } else { // otherwise min came from c[2] or c[3], so recompute y.
@@ -671,7 +686,7 @@ namespace algorithms {
                 assert (safe >= 0);
                 if (safe == 0) {
                     // as above, eliminate one run after tree cleanup
-                    *l++ = *(z.first);
+                    *l++ = std::move(*(z.first));
                     --todo;
                     auto other = z.second ? y : x;
                     // outputting other now gets absurdly messy; instead roll back into its run
@@ -699,7 +714,7 @@ namespace algorithms {
                 } else {
                     todo -= safe;
                     for (; safe > 0; --safe) {
-                        *l++ = *(z.first);
+                        *l++ = std::move(*(z.first));
                         if (z.second) { // min came from c[0] or c[1], so recompute x.
                             x = {*c[0] <= *c[1] ? c[0]++ : c[1]++, true};
                         } else { // otherwise min came from c[2] or c[3], so recompute y.
@@ -716,9 +731,9 @@ namespace algorithms {
 //            assert(nRuns == 2);
             // simple two-way merge
             while (c[0] < e[0] && c[1] < e[1])
-                *l++ = *c[0] <= *c[1] ? *c[0]++ : *c[1]++;
-            while (c[0] < e[0]) *l++ = *c[0]++;
-            while (c[1] < e[1]) *l++ = *c[1]++;
+                *l++ = std::move(*c[0] <= *c[1] ? *c[0]++ : *c[1]++);
+            while (c[0] < e[0]) *l++ = std::move(*c[0]++);
+            while (c[1] < e[1]) *l++ = std::move(*c[1]++);
         }
     }
 
@@ -755,15 +770,16 @@ namespace algorithms {
     void merge_4runs_explicit_nodes(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
         using namespace private_explicit_nodes_;
         typedef typename std::iterator_traits<Iter>::value_type T;
-        const int n = r - l;
+        const auto n = r - l;
         if (COUNT_MERGE_COSTS) totalMergeCosts += n;
         // Copy all runs to B
-        std::copy(l, g1, B);
-        std::copy(g1, g2, B + (g1 - l));
-        std::copy(g2, g3, B + (g2 - l));
-        std::copy(g3, r, B + (g3 - l));
+        std::uninitialized_move(l, g1, B);
+        std::uninitialized_move(g1, g2, B + (g1 - l));
+        std::uninitialized_move(g2, g3, B + (g2 - l));
+        std::uninitialized_move(g3, r, B + (g3 - l));
         if (COUNT_MERGE_COSTS) totalBufferCosts += n;
-        *(B+n) = *(B+n-1); // sentinel value so that accesses to endpoints don't fail
+        if (n > 0) construct_in_buffer(B + n, *(B + n - 1)); // sentinel value so that accesses to endpoints don't fail
+        const buffer_elements inBuffer(B, B + (n > 0 ? n + 1 : 0));
         // initialize pointers to runs in B.
         Iter2 c[4] = {B, B + (g1 - l), B + (g2 - l), B + (g3 - l)}; // current element
         const Iter2 e[4] = {B + (g1 - l), B + (g2 - l), B + (g3 - l), B + n}; // endpoints (for convenience)
@@ -782,7 +798,7 @@ namespace algorithms {
         N[5] = updateTournamentNode<Iter2,2,3>(N);
         N[6] = updateTournamentNode<Iter2,4,5>(N);
         for (auto i = 0; i < n; ++i) {
-            *l++ = *(N[6].it); // copy root to output
+            *l++ = std::move(*(N[6].it)); // copy root to output
             int id = N[6].runId;
             N[id] = {c[id] < e[id], c[id]++, id};
             if (id < 2) { // min came from 0 or 1, so recompute 4.
@@ -810,7 +826,9 @@ namespace algorithms {
         GENERAL_NO_SENTINELS  /** @deprecated */,
         GENERAL_INDICES  /** @deprecated */,
         GENERAL_BY_STAGES,
-        GENERAL_BY_STAGES_SPLIT
+        GENERAL_BY_STAGES_SPLIT,
+        LOSER_TREE,
+        WILLEM_COUNTED
     };
 
     std::string to_string(merging4way_methods implementation) {
@@ -835,41 +853,206 @@ namespace algorithms {
                 return "FOR_NUMERIC_DATA_PLAIN_MIN";
             case GENERAL_BY_STAGES_SPLIT:
                 return "GENERAL_BY_STAGES_SPLIT";
+            case LOSER_TREE:
+                return "LOSER_TREE";
+            case WILLEM_COUNTED:
+                return "WILLEM_COUNTED";
         }
         assert(false);
         __builtin_unreachable();
     };
 
+    /**
+     * Merges runs [l..g1) and [g1..g2) and [g2..g3) and [g3..r) in-place into [l..r)
+     * using a buffer at B of length at least r-l, with the loser tree of merge_kruns;
+     * does not require a sentinel value.
+     */
+    template<typename Iter, typename Iter2>
+    void merge_4runs_loser_tree(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
+        const Iter g[] = {l, g1, g2, g3, r};
+        merge_kruns<4>(g, 4, B);
+    }
+
+    /** Helper methods for merge_4runs_counted */
+    namespace private_counted_ {
+
+        /**
+         * merges the nRuns non-empty runs [c[i]..e[i]) to o in stages:
+         * each stage runs the tournament tree of merge_4runs_numeric_willem_tuned for
+         * exactly as many steps as it takes to exhaust the first run (see first_exhausted_run),
+         * then hands the element left in the other subtree back to its run,
+         * removes the exhausted run and continues with nRuns-1 runs.
+         */
+        template<unsigned nRuns, typename Iter, typename Iter2>
+        void merge_stages(Iter o, Iter2 *c, Iter2 *e) {
+            if constexpr (nRuns == 1) {
+                std::move(c[0], e[0], o);
+            } else {
+                size_t steps;
+                const unsigned f = first_exhausted_run(c, e, nRuns, steps);
+                if constexpr (nRuns == 2) {
+                    Iter2 c0 = c[0], c1 = c[1];
+                    for (; steps > 0; --steps)
+                        *o++ = std::move(*c0 <= *c1 ? *c0++ : *c1++);
+                    c[0] = c0, c[1] = c1;
+                } else {
+                    // tournament tree:
+                    //       z
+                    //    /     \
+                    //   x       y
+                    //  / \     / \
+                    // c[0] c[1] c[2] c[3] (c[3] only if nRuns == 4)
+                    Iter2 x, y;
+                    std::pair<Iter2, bool> z;
+                    if (*c[0] <= *c[1]) x = c[0]++; else x = c[1]++;
+                    if (nRuns == 3 || *c[2] <= *c[3]) y = c[2]++; else y = c[3]++;
+                    if (*x <= *y) z = {x, true}; else z = {y, false};
+                    while (true) {
+                        *o++ = std::move(*(z.first));
+                        if (--steps == 0) break;
+                        if (z.second) { // min came from c[0] or c[1], so recompute x.
+                            if (*c[0] <= *c[1]) x = c[0]++; else x = c[1]++;
+                        } else { // min came from c[2] or c[3], so recompute y.
+                            if (nRuns == 3 || *c[2] <= *c[3]) y = c[2]++; else y = c[3]++;
+                        }
+                        // always recompute z
+                        if (*x <= *y) z = {x, true}; else z = {y, false};
+                    }
+                    // the other child of the root still holds an element; put it back
+                    // (check the left run first: its c - 1 can only be that element if it came from there)
+                    if (z.second) {
+                        if (nRuns == 3 || c[2] - 1 == y) --c[2]; else --c[3];
+                    } else {
+                        if (c[0] - 1 == x) --c[0]; else --c[1];
+                    }
+                }
+                assert(c[f] == e[f]);
+                int n = nRuns;
+                private_stages_split_::remove_run(c, e, n, f);
+                merge_stages<nRuns - 1>(o, c, e);
+            }
+        }
+
+        /** calls merge_stages<k> for the runtime k <= maxRuns */
+        template<unsigned maxRuns, typename Iter, typename Iter2>
+        void merge_dispatch(Iter o, Iter2 *c, Iter2 *e, unsigned k) {
+            if constexpr (maxRuns > 0) {
+                if (k == maxRuns) merge_stages<maxRuns>(o, c, e);
+                else merge_dispatch<maxRuns - 1>(o, c, e, k);
+            }
+        }
+
+        /** copies the k runs [g[0]..g[1]), ..., [g[k-1]..g[k]) to B and merges them back */
+        template<unsigned k, typename Iter, typename Iter2>
+        void merge_counted(const Iter *g, Iter2 B) {
+            const Iter l = g[0];
+            const auto n = g[k] - l;
+            if (COUNT_MERGE_COSTS) totalMergeCosts += n;
+            std::uninitialized_move(l, g[k], B);
+            const buffer_elements inBuffer(B, B + n);
+            if (COUNT_MERGE_COSTS) totalBufferCosts += n;
+            Iter2 c[k], e[k]; // current element and end of non-empty runs in B
+            unsigned nRuns = 0;
+            for (unsigned i = 0; i < k; ++i)
+                if (g[i] < g[i + 1]) {
+                    c[nRuns] = B + (g[i] - l);
+                    e[nRuns++] = B + (g[i + 1] - l);
+                }
+            merge_dispatch<k>(l, c, e, nRuns);
+        }
+    }
+
+    /**
+     * 4way merge with the inner loop of merge_4runs_numeric_willem_tuned, but without sentinels:
+     * the loop runs for a precomputed number of steps until the first run is exhausted,
+     * then continues with a 3way merge etc. (see private_counted_::merge_stages).
+     *
+     * Merges runs [l..g1) and [g1..g2) and [g2..g3) and [g3..r) in-place into [l..r)
+     * using a buffer at B of length at least r-l.
+     */
+    template<typename Iter, typename Iter2>
+    void merge_4runs_counted(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
+        const Iter g[] = {l, g1, g2, g3, r};
+        private_counted_::merge_counted<4>(g, B);
+    }
+
+    /** whether mergingMethod needs sentinel values, i.e., std::numeric_limits for the elements */
+    constexpr bool needs_sentinels(merging4way_methods mergingMethod) {
+        return mergingMethod != GENERAL_NO_SENTINELS && mergingMethod != GENERAL_INDICES &&
+               mergingMethod != GENERAL_BY_STAGES && mergingMethod != GENERAL_BY_STAGES_SPLIT &&
+               mergingMethod != LOSER_TREE && mergingMethod != WILLEM_COUNTED;
+    }
+
+    template<merging4way_methods mergingMethod, bool trim = false,
+            merging_methods twoWayMergingMethod = COPY_BOTH, typename Iter, typename Iter2>
+    void merge_3runs(Iter l, Iter g1, Iter g2, Iter r, Iter2 B); // see merging_3way.h
+
     /**
      * Merges runs [l..g1) and [g1..g2) and [g2..g3) and [g3..r) in-place into [l..r)
      * using a buffer B.
+     * If trim is true, elements already in their final position are first excluded
+     * (see trim_runs); if the first or last run vanishes, we continue with a 3-way merge
+     * of the trimmed runs, or a 2-way merge with twoWayMergingMethod if both vanish.
      */
-    template<merging4way_methods mergingMethod, typename Iter, typename Iter2>
+    template<merging4way_methods mergingMethod, bool trim = false,
+            merging_methods twoWayMergingMethod = COPY_BOTH, typename Iter, typename Iter2>
     void merge_4runs(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B) {
-        switch (mergingMethod) {
-            case merging4way_methods::FOR_NUMERIC_DATA:
-                return merge_4runs_numeric(l, g1, g2, g3, r, B);
-            case merging4way_methods::GENERAL_NO_SENTINELS:
-                return merge_4runs_explicit_nodes(l, g1, g2, g3, r, B);
-            case merging4way_methods::WILLEM:
-                return merge_4runs_numeric_willem(l, g1, g2, g3, r, B);
-            case merging4way_methods::WILLEM_TUNED:
-                return merge_4runs_numeric_willem_tuned(l, g1, g2, g3, r, B);
-            case merging4way_methods::WILLEM_VALUES:
-                return wb_merge4way3(l, g1, g2, g3, r, B);
-            case merging4way_methods::WILLEM_WITH_INDICES:
-                return merge_4runs_numeric_willem_a(l, g1, g2, g3, r, B);
-            case merging4way_methods::GENERAL_INDICES:
-                return merge_4runs_indices(l, g1, g2, g3, r, B);
-            case merging4way_methods::GENERAL_BY_STAGES:
-                return merge_4runs_by_stages(l, g1, g2, g3, r, B);
-            case merging4way_methods::FOR_NUMERIC_DATA_PLAIN_MIN:
-                return merge_4runs_numeric_plain_min(l, g1, g2, g3, r, B);
-            case merging4way_methods::GENERAL_BY_STAGES_SPLIT:
-                return merge_4runs_by_stages_split(l, g1, g2, g3, r, B);
-            default:
-                assert(false);
-                __builtin_unreachable();
+        if (trim) {
+            Iter b[] = {l, g1, g2, g3, r};
+            trim_runs(b);
+            l = b[0], r = b[4];
+            if (l == g1 && g3 == r) return merge_runs<twoWayMergingMethod>(g1, g2, g3, B);
+            if (l == g1) return merge_3runs<mergingMethod, false, twoWayMergingMethod>(g1, g2, g3, r, B);
+            if (g3 == r) return merge_3runs<mergingMethod, false, twoWayMergingMethod>(l, g1, g2, g3, B);
+        }
+        typedef typename std::iterator_traits<Iter>::value_type T;
+        if constexpr (!std::numeric_limits<T>::is_specialized) {
+            // only instantiate the methods that work without sentinels
+            static_assert(!needs_sentinels(mergingMethod), "Needs numeric type (for sentinels)");
+            switch (mergingMethod) {
+                case merging4way_methods::GENERAL_NO_SENTINELS:
+                    return merge_4runs_explicit_nodes(l, g1, g2, g3, r, B);
+                case merging4way_methods::GENERAL_INDICES:
+                    return merge_4runs_indices(l, g1, g2, g3, r, B);
+                case merging4way_methods::GENERAL_BY_STAGES:
+                    return merge_4runs_by_stages(l, g1, g2, g3, r, B);
+                case merging4way_methods::LOSER_TREE:
+                    return merge_4runs_loser_tree(l, g1, g2, g3, r, B);
+                case merging4way_methods::WILLEM_COUNTED:
+                    return merge_4runs_counted(l, g1, g2, g3, r, B);
+                default:
+                    return merge_4runs_by_stages_split(l, g1, g2, g3, r, B);
+            }
+        } else {
+            switch (mergingMethod) {
+                case merging4way_methods::FOR_NUMERIC_DATA:
+                    return merge_4runs_numeric(l, g1, g2, g3, r, B);
+                case merging4way_methods::GENERAL_NO_SENTINELS:
+                    return merge_4runs_explicit_nodes(l, g1, g2, g3, r, B);
+                case merging4way_methods::WILLEM:
+                    return merge_4runs_numeric_willem(l, g1, g2, g3, r, B);
+                case merging4way_methods::WILLEM_TUNED:
+                    return merge_4runs_numeric_willem_tuned(l, g1, g2, g3, r, B);
+                case merging4way_methods::WILLEM_VALUES:
+                    return wb_merge4way3(l, g1, g2, g3, r, B);
+                case merging4way_methods::WILLEM_WITH_INDICES:
+                    return merge_4runs_numeric_willem_a(l, g1, g2, g3, r, B);
+                case merging4way_methods::GENERAL_INDICES:
+                    return merge_4runs_indices(l, g1, g2, g3, r, B);
+                case merging4way_methods::GENERAL_BY_STAGES:
+                    return merge_4runs_by_stages(l, g1, g2, g3, r, B);
+                case merging4way_methods::FOR_NUMERIC_DATA_PLAIN_MIN:
+                    return merge_4runs_numeric_plain_min(l, g1, g2, g3, r, B);
+                case merging4way_methods::GENERAL_BY_STAGES_SPLIT:
+                    return merge_4runs_by_stages_split(l, g1, g2, g3, r, B);
+                case merging4way_methods::LOSER_TREE:
+                    return merge_4runs_loser_tree(l, g1, g2, g3, r, B);
+                case merging4way_methods::WILLEM_COUNTED:
+                    return merge_4runs_counted(l, g1, g2, g3, r, B);
+                default:
+                    assert(false);
+                    __builtin_unreachable();
+            }
         }
 
     }
@@ -0,0 +1,166 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_MERGING_PARALLEL_H
+#define MERGESORTS_MERGING_PARALLEL_H
+
+#include <algorithm>
+#include <cassert>
+#include "merging.h"
+#include "work_stealing_pool.h"
+
+namespace algorithms {
+
+	/**
+	 * Co-ranking (a.k.a. merge path) for the stable merge of sorted [a, a+n1) and [b, b+n2),
+	 * where elements from a win ties.
+	 * Returns i such that the first k elements of the merged output are
+	 * [a, a+i) and [b, b+(k-i)).
+	 */
+	template<typename Iter1, typename Iter2>
+	ptrdiff_t co_rank(ptrdiff_t k, Iter1 a, ptrdiff_t n1, Iter2 b, ptrdiff_t n2) {
+		ptrdiff_t lo = std::max<ptrdiff_t>(0, k - n2), hi = std::min(k, n1);
+		while (lo < hi) {
+			ptrdiff_t i = lo + (hi - lo) / 2, j = k - i;
+			// a[i] <= b[j-1] means a[i] comes before b[j-1]: take more from a
+			if (!(*(b + (j - 1)) < *(a + i))) lo = i + 1;
+			else hi = i;
+		}
+		return lo;
+	}
+
+	/**
+	 * Stable merge of sorted [l1,r1) and [l2,r2) to out; elements from the first run win ties.
+	 * out must not overlap with either run.
+	 * If toBuffer, out is uninitialized storage (see scratch_space) and the elements are
+	 * move-constructed there.
+	 */
+	template<bool toBuffer = false, typename Iter1, typename Iter2, typename OutIter>
+	void merge_disjoint(Iter1 l1, Iter1 r1, Iter2 l2, Iter2 r2, OutIter out) {
+		if constexpr (toBuffer) {
+			while (l1 < r1 && l2 < r2)
+				construct_in_buffer(out++, std::move(*l2 < *l1 ? *l2++ : *l1++));
+			out = std::uninitialized_move(l1, r1, out);
+			std::uninitialized_move(l2, r2, out);
+		} else {
+			while (l1 < r1 && l2 < r2)
+				*out++ = std::move(*l2 < *l1 ? *l2++ : *l1++);
+			out = std::move(l1, r1, out);
+			std::move(l2, r2, out);
+		}
+	}
+
+	/** maximal number of pieces a parallel merge is split into */
+	const size_t MAX_MERGE_PIECES = 256;
+
+	/**
+	 * Merges sorted [l1,r1) and [l2,r2) to out (not overlapping the runs),
+	 * split into one piece of equal output size per thread of pool (at most MAX_MERGE_PIECES).
+	 * Piece boundaries are found by co-ranking, so each thread only touches
+	 * its own part of out.
+	 * Elements are moved, so all co-ranks are computed before any piece is merged.
+	 * If toBuffer, out is uninitialized storage (see merge_disjoint).
+	 */
+	template<bool toBuffer = false, typename Iter1, typename Iter2, typename OutIter>
+	void parallel_merge(Iter1 l1, Iter1 r1, Iter2 l2, Iter2 r2, OutIter out, work_stealing_pool &pool) {
+		const ptrdiff_t n1 = r1 - l1, n2 = r2 - l2, n = n1 + n2;
+		const size_t nPieces = std::min<size_t>(pool.n_threads(), MAX_MERGE_PIECES);
+		ptrdiff_t splits[MAX_MERGE_PIECES + 1]; // co-ranks of piece boundaries
+		for (size_t p = 0; p <= nPieces; ++p)
+			splits[p] = co_rank((n * (ptrdiff_t) p) / (ptrdiff_t) nPieces, l1, n1, l2, n2);
+		pool.parallel_for(nPieces, [=, &splits](size_t p) {
+			const ptrdiff_t kBegin = (n * p) / nPieces, kEnd = (n * (p + 1)) / nPieces;
+			const ptrdiff_t iBegin = splits[p], iEnd = splits[p + 1];
+			merge_disjoint<toBuffer>(l1 + iBegin, l1 + iEnd,
+			               l2 + (kBegin - iBegin), l2 + (kEnd - iEnd),
+			               out + kBegin);
+		});
+	}
+
+	/**
+	 * moves [l,r) to out with one piece per thread of pool;
+	 * if toBuffer, out is uninitialized storage and the elements are move-constructed there
+	 */
+	template<bool toBuffer = false, typename Iter1, typename OutIter>
+	void parallel_copy(Iter1 l, Iter1 r, OutIter out, work_stealing_pool &pool) {
+		const ptrdiff_t n = r - l;
+		const size_t nPieces = pool.n_threads();
+		pool.parallel_for(nPieces, [=](size_t p) {
+			const ptrdiff_t begin = (n * p) / nPieces, end = (n * (p + 1)) / nPieces;
+			if constexpr (toBuffer) std::uninitialized_move(l + begin, l + end, out + begin);
+			else std::move(l + begin, l + end, out + begin);
+		});
+	}
+
+	/**
+	 * Merges runs [l..m) and [m..r) in place into [l..r),
+	 * using all threads of pool.
+	 * The runs are merged into the buffer, which must have space for r-l elements,
+	 * and the result is copied back.
+	 * If trim is true, elements already in their final position are first excluded (see trim_runs).
+	 */
+	template<bool trim = false, typename Iter, typename Iter2>
+	void parallel_merge_runs(Iter l, Iter m, Iter r, Iter2 B, work_stealing_pool &pool) {
+		if (trim) {
+			Iter b[] = {l, m, r};
+			trim_runs(b);
+			l = b[0], r = b[2];
+			if (l == m || m == r) return;
+		}
+		if (COUNT_MERGE_COSTS) totalMergeCosts += (r-l);
+		parallel_merge<true>(l, m, m, r, B, pool);
+		const buffer_elements inBuffer(B, B + (r - l));
+		parallel_copy(B, B + (r - l), l, pool);
+		if (COUNT_MERGE_COSTS) totalBufferCosts += (r-l);
+	}
+
+	/**
+	 * Merges runs [l..g1), [g1..g2) and [g2..r) in place into [l..r),
+	 * using all threads of pool.
+	 * The first two runs are merged into the buffer, which must have space for r-l elements,
+	 * the third one is copied there, and the result is merged back.
+	 * If trim is true, elements already in their final position are first excluded (see trim_runs).
+	 */
+	template<bool trim = false, typename Iter, typename Iter2>
+	void parallel_merge_3runs(Iter l, Iter g1, Iter g2, Iter r, Iter2 B, work_stealing_pool &pool) {
+		if (trim) {
+			Iter b[] = {l, g1, g2, r};
+			trim_runs(b);
+			l = b[0], r = b[3];
+			if (l == g1) return parallel_merge_runs<true>(g1, g2, r, B, pool);
+			if (g2 == r) return parallel_merge_runs<true>(l, g1, g2, B, pool);
+		}
+		if (COUNT_MERGE_COSTS) totalMergeCosts += (r-l);
+		parallel_merge<true>(l, g1, g1, g2, B, pool);
+		parallel_copy<true>(g2, r, B + (g2 - l), pool);
+		const buffer_elements inBuffer(B, B + (r - l));
+		if (COUNT_MERGE_COSTS) totalBufferCosts += (r-l);
+		parallel_merge(B, B + (g2 - l), B + (g2 - l), B + (r - l), l, pool);
+	}
+
+	/**
+	 * Merges runs [l..g1), [g1..g2), [g2..g3) and [g3..r) in place into [l..r),
+	 * using all threads of pool.
+	 * Both pairs of runs are merged into the buffer, which must have space for r-l elements,
+	 * and the two results are merged back.
+	 * If trim is true, elements already in their final position are first excluded (see trim_runs).
+	 */
+	template<bool trim = false, typename Iter, typename Iter2>
+	void parallel_merge_4runs(Iter l, Iter g1, Iter g2, Iter g3, Iter r, Iter2 B, work_stealing_pool &pool) {
+		if (trim) {
+			Iter b[] = {l, g1, g2, g3, r};
+			trim_runs(b);
+			l = b[0], r = b[4];
+			if (l == g1) return parallel_merge_3runs<true>(g1, g2, g3, r, B, pool);
+			if (g3 == r) return parallel_merge_3runs<true>(l, g1, g2, g3, B, pool);
+		}
+		if (COUNT_MERGE_COSTS) totalMergeCosts += (r-l);
+		parallel_merge<true>(l, g1, g1, g2, B, pool);
+		parallel_merge<true>(g2, g3, g3, r, B + (g2 - l), pool);
+		const buffer_elements inBuffer(B, B + (r - l));
+		if (COUNT_MERGE_COSTS) totalBufferCosts += (r-l);
+		parallel_merge(B, B + (g2 - l), B + (g2 - l), B + (r - l), l, pool);
+	}
+
+}
+
+#endif //MERGESORTS_MERGING_PARALLEL_H
@@ -0,0 +1,154 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_MERGING_SIMD_H
+#define MERGESORTS_MERGING_SIMD_H
+
+#include <cstddef>
+#include "run_detection_simd.h"
+
+namespace algorithms {
+
+	/**
+	 * Merging of arrays of 32- and 64-bit signed integers with a bitonic merge network
+	 * on AVX2 registers (8 resp. 4 elements), following Inoue et al. (PACT 2007):
+	 * The network merges the next register of input with the register of the largest
+	 * elements seen so far; the smaller half is output.
+	 * The next input register is taken from the run whose next element is smaller.
+	 *
+	 * The network does not preserve the order of equal elements, but for plain integers
+	 * this cannot be observed.
+	 */
+	namespace simd {
+
+		/** merges sorted [a,aEnd) and [b,bEnd) to out (not overlapping them) */
+		template<typename T>
+		T *merge_scalar(const T *a, const T *aEnd, const T *b, const T *bEnd, T *out) {
+			while (a < aEnd && b < bEnd) *out++ = *b < *a ? *b++ : *a++;
+			while (a < aEnd) *out++ = *a++;
+			while (b < bEnd) *out++ = *b++;
+			return out;
+		}
+
+#ifdef MERGESORTS_X86_SIMD
+
+		/** number of elements of T per AVX2 register */
+		template<typename T>
+		constexpr size_t avx2_lanes = 32 / sizeof(T);
+
+		template<typename T>
+		__attribute__((target("avx2")))
+		inline __m256i load_register(const T *p) {
+			return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+		}
+
+		template<typename T>
+		__attribute__((target("avx2")))
+		inline void store_register(T *p, __m256i v) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+		}
+
+		template<typename T>
+		__attribute__((target("avx2")))
+		inline void min_max(__m256i x, __m256i y, __m256i &min, __m256i &max) {
+			if constexpr (sizeof(T) == 4) {
+				min = _mm256_min_epi32(x, y);
+				max = _mm256_max_epi32(x, y);
+			} else {
+				const __m256i greater = _mm256_cmpgt_epi64(x, y);
+				min = _mm256_blendv_epi8(x, y, greater);
+				max = _mm256_blendv_epi8(y, x, greater);
+			}
+		}
+
+		/** sorts a bitonic register by half-cleaners of distance lanes/2, ..., 1 */
+		template<typename T>
+		__attribute__((target("avx2")))
+		inline __m256i sort_bitonic(__m256i v) {
+			__m256i min, max;
+			if constexpr (sizeof(T) == 4) {
+				min_max<T>(v, _mm256_permute2x128_si256(v, v, 1), min, max);
+				v = _mm256_blend_epi32(min, max, 0xF0);
+				min_max<T>(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)), min, max);
+				v = _mm256_blend_epi32(min, max, 0xCC);
+				min_max<T>(v, _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)), min, max);
+				return _mm256_blend_epi32(min, max, 0xAA);
+			} else {
+				min_max<T>(v, _mm256_permute4x64_epi64(v, _MM_SHUFFLE(1, 0, 3, 2)), min, max);
+				v = _mm256_blend_epi32(min, max, 0xF0);
+				min_max<T>(v, _mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 3, 0, 1)), min, max);
+				return _mm256_blend_epi32(min, max, 0xCC);
+			}
+		}
+
+		/** for sorted registers lo and hi, puts the smaller half of their elements into lo and the rest into hi, both sorted */
+		template<typename T>
+		__attribute__((target("avx2")))
+		inline void merge_registers(__m256i &lo, __m256i &hi) {
+			__m256i reversed;
+			if constexpr (sizeof(T) == 4)
+				reversed = _mm256_permutevar8x32_epi32(hi, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+			else
+				reversed = _mm256_permute4x64_epi64(hi, _MM_SHUFFLE(0, 1, 2, 3));
+			__m256i min, max;
+			min_max<T>(lo, reversed, min, max); // both bitonic, all of min <= all of max
+			lo = sort_bitonic<T>(min);
+			hi = sort_bitonic<T>(max);
+		}
+
+		/**
+		 * merges sorted [a,aEnd) and [b,bEnd) to out (not overlapping them);
+		 * both runs must have at least avx2_lanes<T> elements.
+		 */
+		template<typename T>
+		__attribute__((target("avx2")))
+		void merge_bitonic_avx2(const T *a, const T *aEnd, const T *b, const T *bEnd, T *out) {
+			constexpr ptrdiff_t lanes = avx2_lanes<T>;
+			__m256i lo = load_register(a), hi = load_register(b);
+			a += lanes, b += lanes;
+			while (true) {
+				merge_registers<T>(lo, hi);
+				store_register(out, lo);
+				out += lanes;
+				if (aEnd - a < lanes || bEnd - b < lanes) break;
+				if (*a <= *b) lo = load_register(a), a += lanes;
+				else lo = load_register(b), b += lanes;
+			}
+			// everything output so far is <= hi and the rest of both runs; one of which is shorter than lanes
+			T carry[lanes], head[2 * lanes];
+			store_register(carry, hi);
+			if (aEnd - a < lanes) {
+				T *headEnd = merge_scalar(carry, carry + lanes, a, aEnd, head);
+				merge_scalar(head, headEnd, b, bEnd, out);
+			} else {
+				T *headEnd = merge_scalar(carry, carry + lanes, b, bEnd, head);
+				merge_scalar(head, headEnd, a, aEnd, out);
+			}
+		}
+
+#endif // MERGESORTS_X86_SIMD
+
+		/** whether merge_bitonic can be used for runs of n1 and n2 elements of type T on this CPU */
+		template<typename T>
+		bool can_merge_bitonic(size_t n1, size_t n2) {
+#ifdef MERGESORTS_X86_SIMD
+			return n1 >= avx2_lanes<T> && n2 >= avx2_lanes<T> && has_avx2();
+#else
+			return false;
+#endif
+		}
+
+		/** merges sorted [a,aEnd) and [b,bEnd) to out (not overlapping them); requires can_merge_bitonic */
+		template<typename T>
+		void merge_bitonic(const T *a, const T *aEnd, const T *b, const T *bEnd, T *out) {
+#ifdef MERGESORTS_X86_SIMD
+			merge_bitonic_avx2(a, aEnd, b, bEnd, out);
+#else
+			merge_scalar(a, aEnd, b, bEnd, out);
+#endif
+		}
+
+	}
+
+}
+
+#endif //MERGESORTS_MERGING_SIMD_H
@@ -8,6 +8,7 @@
 #include <iostream>
 #include "../algorithms.h"
 #include "insertionsort.h"
+#include "small_sort.h"
 #include "merging.h"
 #include <vector>
 
@@ -18,7 +19,8 @@ namespace algorithms {
 	 * (https://www.wild-inter.net/publications/munro-wild-2018).
 	 *
 	 * If the subproblem has size at most insertionsortThreshold,
-	 * it is sorted by straight insertion sort instead of merging.
+	 * it is sorted by straight insertion sort (or another smallSortMethod, see small_sort.h)
+	 * instead of merging.
 	 * If onlyIncreasingRuns is true, we only find weakly increasing runs
 	 * while peeking into the middle. That simplifies run detection a bit,
 	 * but it does not detect descending runs.
@@ -26,19 +28,28 @@ namespace algorithms {
 	 * @author Sebastian Wild (wild@liverpool.ac.uk)
 	 */
 	template<typename Iterator, unsigned int insertionsortThreshold = 24, bool onlyIncreasingRuns = false,
-	        merging_methods mergingMethod = COPY_BOTH>
+	        merging_methods mergingMethod = COPY_BOTH, small_sort_methods smallSortMethod = INSERTIONSORT>
 	class peeksort final : public sorter<Iterator> {
 	private:
 		using typename sorter<Iterator>::elem_t;
 		using typename sorter<Iterator>::diff_t;
-		std::vector<elem_t> _buffer;
+		scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+		elem_t *_buffer = nullptr;
+		size_t _bufferSize = 0;
+		int _minGallop = MIN_GALLOP; // galloping threshold, kept across the merges of a sort
 #ifdef DEBUG_SORTING
 		Iterator globalBegin, globalEnd;
 #endif
 	public:
 
 		void sort(Iterator begin, Iterator end) override {
-			_buffer.resize(end - begin);
+			sort(begin, end, _ownScratch);
+		}
+
+		void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
+			_bufferSize = uses_buffer(mergingMethod) ? end - begin : 0;
+			_buffer = scratch.get(_bufferSize);
+			_minGallop = MIN_GALLOP;
 #ifdef DEBUG_SORTING
 			globalBegin = begin; globalEnd = end; // for debug
 #endif
@@ -96,7 +107,7 @@ namespace algorithms {
 
 			size_t n = end - begin;
 			if (n <= insertionsortThreshold)
-				return insertionsort(begin, end, leftRunEnd);
+				return small_sort<smallSortMethod>(begin, end, leftRunEnd);
 			Iterator m = begin + (n >> 1); // middle split between m and m-1
 #ifdef DEBUG_SORTING
 			debug(begin, end, leftRunEnd, rightRunBegin, m);
@@ -104,11 +115,11 @@ namespace algorithms {
 			if (m <= leftRunEnd) {
 				// |XXXXXXXX|XX     X|
 				peek_sort(leftRunEnd, end, leftRunEnd + 1, rightRunBegin);
-				merge_runs<mergingMethod>(begin, leftRunEnd, end, _buffer.begin());
+				merge_runs<mergingMethod>(begin, leftRunEnd, end, _buffer, _minGallop);
 			} else if (m >= rightRunBegin) {
 				// |XX     X|XXXXXXXX|
 				peek_sort(begin, rightRunBegin, leftRunEnd, rightRunBegin-1);
-				merge_runs<mergingMethod>(begin, rightRunBegin, end, _buffer.begin());
+				merge_runs<mergingMethod>(begin, rightRunBegin, end, _buffer, _minGallop);
 			} else {
 				// find middle run, i.e., run containing m-1
 				Iterator i, j;
@@ -134,21 +145,24 @@ namespace algorithms {
 					// |XX     x|xxxx   X|
 					peek_sort(begin, i, leftRunEnd, i-1);
 					peek_sort(i, end, j, rightRunBegin);
-					merge_runs<mergingMethod>(begin, i, end, _buffer.begin());
+					merge_runs<mergingMethod>(begin, i, end, _buffer, _minGallop);
 				} else {
 					// |XX   xxx|x      X|
 					peek_sort(begin, j, leftRunEnd, i);
 					peek_sort(j, end, j+1, rightRunBegin);
-					merge_runs<mergingMethod>(begin, j, end, _buffer.begin());
+					merge_runs<mergingMethod>(begin, j, end, _buffer, _minGallop);
 				}
 			}
 
 		}
 
+		long long scratch_elements() const override { return _bufferSize; }
+
 		std::string name() const override {
 			return "PeekSort+iscutoff=" + std::to_string(insertionsortThreshold) +
 			       "+onlyIncRuns=" + std::to_string(onlyIncreasingRuns) +
-                   "+mergingMethod=" + to_string(mergingMethod);
+                   "+mergingMethod=" + to_string(mergingMethod) +
+                   (smallSortMethod != INSERTIONSORT ? "+smallSort=" + to_string(smallSortMethod) : "");
 		}
 	};
 
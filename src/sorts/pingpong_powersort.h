@@ -0,0 +1,183 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_PINGPONG_POWERSORT_H
+#define MERGESORTS_PINGPONG_POWERSORT_H
+
+#include <cassert>
+#include <string>
+#include "../algorithms.h"
+#include "merging.h"
+#include "powersort.h"
+#include "small_sort.h"
+
+namespace algorithms {
+
+	/**
+	 * Powersort that merges back and forth between the array and the buffer ("ping-pong")
+	 * instead of copying both runs to the buffer and merging back for every merge:
+	 * each run on the stack remembers whether it currently lives in the array or at the
+	 * same offsets in the buffer.
+	 *  - Two runs in the same place are merged into the other place.
+	 *  - A run in the array and one in the buffer are merged into the array, from the back
+	 *    if the left run is in the array and from the front otherwise; so the output never
+	 *    overtakes the unread part of the run in the array, and the rest of that run is
+	 *    already in place when the other one is exhausted.
+	 * So every merge moves each element (at most) once, instead of twice.
+	 * If the sorted result ends up in the buffer, it is moved back once at the end.
+	 * Runs are move-constructed into the (uninitialized) buffer and destroyed there
+	 * once they are merged back, so the buffer holds elements only while runs live there.
+	 *
+	 * The merge tree is the same as for powersort; runs are extended to minRunLen with
+	 * smallSortMethod if needed. Needs n elements of scratch space.
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename Iterator,
+			unsigned int minRunLen = 24,
+			small_sort_methods smallSortMethod = INSERTIONSORT
+	>
+	class pingpong_powersort final : public sorter<Iterator> {
+	private:
+		using typename sorter<Iterator>::elem_t;
+		scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+		elem_t *_buffer = nullptr;
+		size_t _bufferSize = 0;
+		Iterator _begin; // run [i,j) is at [_begin+i.._begin+j) or [_buffer+i.._buffer+j)
+
+		struct run_begin_n_power {
+			size_t begin;
+			power_t power = 0;
+			bool inBuffer = false;
+		};
+
+		struct run_n_power {
+			size_t begin, end;
+			power_t power = 0;
+			bool inBuffer = false;
+		};
+
+	public:
+
+		void sort(Iterator begin, Iterator end) override {
+			sort(begin, end, _ownScratch);
+		}
+
+		void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
+			_bufferSize = end - begin;
+			_buffer = scratch.get(_bufferSize);
+			_begin = begin;
+			power_sort(begin, end);
+		}
+
+		long long scratch_elements() const override { return _bufferSize; }
+
+		std::string name() const override {
+			return "PingPongPowerSort+minRunLen=" + std::to_string(minRunLen) +
+			       (smallSortMethod != INSERTIONSORT ? "+smallSort=" + to_string(smallSortMethod) : "");
+		}
+
+	private:
+
+		/** extends the run starting at begin to minRunLen (if possible) and returns its end */
+		Iterator next_run(Iterator begin, Iterator end) {
+			Iterator runEnd = extend_and_reverse_run_right(begin, end);
+			size_t len = runEnd - begin;
+			if (len < minRunLen) {
+				runEnd = std::min(end, begin + minRunLen);
+				small_sort<smallSortMethod>(begin, runEnd, len);
+			}
+			return runEnd;
+		}
+
+		/**
+		 * merges [a..aEnd) and [b..bEnd) to o, front to back; returns the end of the output.
+		 * If toBuffer, o is uninitialized storage and the elements are move-constructed there.
+		 */
+		template<bool toBuffer, typename IterA, typename IterB, typename IterOut>
+		static IterOut merge_forward(IterA a, IterA aEnd, IterB b, IterB bEnd, IterOut o) {
+			if constexpr (toBuffer) {
+				while (a < aEnd && b < bEnd)
+					construct_in_buffer(o++, std::move(*b < *a ? *b++ : *a++));
+				o = std::uninitialized_move(a, aEnd, o);
+				return std::uninitialized_move(b, bEnd, o);
+			} else {
+				while (a < aEnd && b < bEnd)
+					*o++ = std::move(*b < *a ? *b++ : *a++);
+				o = std::move(a, aEnd, o);
+				return std::move(b, bEnd, o);
+			}
+		}
+
+		/**
+		 * merges runs [l,m) and [m,r), where the left run is in the buffer iff leftInBuffer
+		 * and the right one iff rightInBuffer; returns whether the result is in the buffer
+		 */
+		bool merge(size_t l, size_t m, size_t r, bool leftInBuffer, bool rightInBuffer) {
+			if (COUNT_MERGE_COSTS) totalMergeCosts += (r - l);
+			if (leftInBuffer == rightInBuffer) {
+				if (leftInBuffer) {
+					merge_forward<false>(_buffer + l, _buffer + m, _buffer + m, _buffer + r, _begin + l);
+					std::destroy(_buffer + l, _buffer + r);
+				} else {
+					merge_forward<true>(_begin + l, _begin + m, _begin + m, _begin + r, _buffer + l);
+				}
+				return !leftInBuffer;
+			}
+			if (rightInBuffer) {
+				// back to front into the array; the rest of the left run is then in place
+				Iterator a = _begin + l, aEnd = _begin + m, o = _begin + r;
+				elem_t *b = _buffer + m, *bEnd = _buffer + r;
+				while (a < aEnd && b < bEnd)
+					*--o = std::move(*(bEnd - 1) < *(aEnd - 1) ? *--aEnd : *--bEnd);
+				std::move_backward(b, bEnd, o);
+				std::destroy(_buffer + m, _buffer + r);
+			} else {
+				// front to back into the array; the rest of the right run is then in place
+				elem_t *a = _buffer + l, *aEnd = _buffer + m;
+				Iterator b = _begin + m, bEnd = _begin + r, o = _begin + l;
+				while (a < aEnd && b < bEnd)
+					*o++ = std::move(*b < *a ? *b++ : *a++);
+				std::move(a, aEnd, o);
+				std::destroy(_buffer + l, _buffer + m);
+			}
+			return false;
+		}
+
+		void power_sort(Iterator begin, Iterator end) {
+			const size_t n = end - begin;
+			if (n == 0) return;
+			const unsigned maxStackHeight = floor_log2(n) + 1;
+			run_begin_n_power stack[maxStackHeight];
+			unsigned top = 0; // topmost occupied entry in stack; keep power-0 entry in stack[0]
+			stack[0] = {0, 0, false};
+
+			run_n_power runA = {0, (size_t) (next_run(begin, end) - begin), 0, false};
+			while (runA.end < n) {
+				size_t runBEnd = next_run(begin + runA.end, end) - begin;
+				runA.power = node_power_clz(0, n, runA.begin, runA.end, runBEnd);
+				// Invariant: powers on stack must be increasing from bottom to top
+				while (stack[top].power > runA.power) {
+					auto topRun = stack[top--]; // pop
+					runA.inBuffer = merge(topRun.begin, runA.begin, runA.end, topRun.inBuffer, runA.inBuffer);
+					runA.begin = topRun.begin;
+				}
+				stack[++top] = {runA.begin, runA.power, runA.inBuffer}; // push
+				runA = {runA.end, runBEnd, 0, false};
+			}
+			assert(runA.end == n);
+			while (top > 0) {
+				auto topRun = stack[top--]; // pop
+				runA.inBuffer = merge(topRun.begin, runA.begin, n, topRun.inBuffer, runA.inBuffer);
+				runA.begin = topRun.begin;
+			}
+			if (runA.inBuffer) {
+				std::move(_buffer, _buffer + n, begin);
+				std::destroy(_buffer, _buffer + n);
+				if (COUNT_MERGE_COSTS) totalBufferCosts += n;
+			}
+		}
+	};
+
+}
+
+#endif //MERGESORTS_PINGPONG_POWERSORT_H
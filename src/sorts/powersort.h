@@ -6,7 +6,11 @@
 #include <cassert>
 #include "../algorithms.h"
 #include "insertionsort.h"
+#include "small_sort.h"
 #include "merging.h"
+#include "merging_parallel.h"
+#include <limits>
+#include <memory>
 #include <vector>
 
 namespace algorithms {
@@ -87,45 +91,33 @@ namespace algorithms {
 		return nCommonBits + 1;
 	}
 
+    /**
+     * Returns the number of leading zeros of a XOR b, where a and b are l2/(2n) and r2/(2n)
+     * (both in [0,1)) as binary fixed-point fractions in a word with a leading zero bit;
+     * this is 1 + the number of common leading bits of their fractional parts.
+     * Exact for all n < 2^63: for n <= 2^31, 31 fraction bits (in 64-bit arithmetic) suffice;
+     * larger n take 63 fraction bits computed with a 128-bit division.
+     */
+    inline unsigned fraction_prefix_clz(size_t n, size_t l2, size_t r2) {
+        static_assert(sizeof(size_t) == 8, "assume 64bit size_t");
+        assert(l2 < r2 && r2 <= 2 * n);
+        if (n <= (1ul << 31)) {
+            auto a = static_cast<unsigned int>((l2 << 30) / n);
+            auto b = static_cast<unsigned int>((r2 << 30) / n);
+            return __builtin_clz(a ^ b);
+        }
+        assert(n < (1ul << 63));
+        auto a = static_cast<unsigned long long>((static_cast<unsigned __int128>(l2) << 62) / n);
+        auto b = static_cast<unsigned long long>((static_cast<unsigned __int128>(r2) << 62) / n);
+        return __builtin_clzll(a ^ b);
+    }
+
     power_t node_power_clz(size_t begin, size_t end,
 	                        size_t beginA, size_t beginB, size_t endB) {
 		size_t n = end - begin;
-		assert(n <= (1L << 31));
 		unsigned long l2 = beginA + beginB - 2*begin; // 2*l
 		unsigned long r2 = beginB + endB - 2*begin;   // 2*r
-		auto a = static_cast<unsigned int>((l2 << 30) / n);
-		auto b = static_cast<unsigned int>((r2 << 30) / n);
-		return __builtin_clz(a ^ b);
-	}
-
-	// not precise enough for large powers ...
-    power_t node_power_clz_unconstrained(ptrdiff_t begin, ptrdiff_t end,
-	                                      ptrdiff_t beginA, ptrdiff_t beginB, ptrdiff_t endB) {
-		assert(begin <= beginA && beginA <= beginB && beginB <= endB && endB <= end);
-		auto n = static_cast<size_t>(end - begin);
-		assert(n < (1L << 63));
-		auto l2 = static_cast<size_t>((beginA - begin) + (beginB - begin)); // 2*l
-		auto r2 = static_cast<size_t>((beginB - begin) + (endB - begin));   // 2*r
-		static_assert(sizeof(size_t) == 8, "assume 64bit size_t"); // can compute with 64 bits
-		// compute low and high 32 bits separately
-		if (n < (1L << 33)) {
-			auto a = static_cast<unsigned int>((l2 << 31) / n);
-			auto b = static_cast<unsigned int>((r2 << 31) / n);
-			return __builtin_clz(a ^ b);
-		} else {
-			auto ah = static_cast<unsigned int>(l2 / (n >> 31));
-			auto bh = static_cast<unsigned int>(r2 / (n >> 31));
-			if (ah != bh) {
-				return __builtin_clz(ah ^ bh);
-			} else {
-				size_t nPrime = (n >> 32) * ah;
-				size_t ll2 = l2 - nPrime;
-				size_t lr2 = r2 - nPrime;
-				auto al = static_cast<unsigned int>((ll2 << 32) / (n >> 31));
-				auto bl = static_cast<unsigned int>((lr2 << 32) / (n >> 31));
-				return 32 + __builtin_clz(al ^ bl);
-			}
-		}
+		return fraction_prefix_clz(n, l2, r2);
 	}
 
 	unsigned floor_log2(unsigned int n) {
@@ -144,27 +136,40 @@ namespace algorithms {
 	 * (https://www.wild-inter.net/publications/munro-wild-2018).
 	 *
 	 * Natural runs are extended to minRunLen if needed before we continue
-	 * merging.
+	 * merging, using smallSortMethod (see small_sort.h).
 	 * Unless useMsbMergeType is false, tournament powers are computed using
 	 * a most-significant-bit trick;
 	 * otherwise a loop is used.
 	 * If onlyIncreasingRuns is true, only weakly increasing runs are picked up.
+	 * If trimRuns is true, each merge first skips elements already in their final place (see trim_runs).
+	 * If halfSizeBuffer is true, only ceil(n/2) elements of scratch space are used;
+	 * merges that need more with mergingMethod use merge_runs_bounded_buffer instead.
+	 * If constructed with nThreads > 1, merges of at least parallelMergeThreshold
+	 * elements are split by co-ranking and done by nThreads threads (see merging_parallel.h).
 	 *
 	 * @author Sebastian Wild (wild@liverpool.ac.uk)
 	 */
 	template<typename Iterator,
 			unsigned int minRunLen = 24,
-            merging_methods mergingMethod = merging_methods::COPY_BOTH,
+            merging_methods mergingMethod = default_merging_method<Iterator>,
             bool onlyIncreasingRuns = false,
 			node_power_implementations nodePowerImplementation = MOST_SIGNIFICANT_SET_BIT /** very little difference */,
-            bool usePowerIndexedStack = false /** no measurable difference */
+            bool usePowerIndexedStack = false /** no measurable difference */,
+            bool trimRuns = false,
+            bool halfSizeBuffer = false,
+            small_sort_methods smallSortMethod = INSERTIONSORT
 	>
 	class powersort final : public sorter<Iterator> {
 	private:
 		using typename sorter<Iterator>::elem_t;
 		using typename sorter<Iterator>::diff_t;
-		std::vector<elem_t> _buffer;
+		scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+		elem_t *_buffer = nullptr;
+		size_t _bufferSize = 0;
 		Iterator globalBegin, globalEnd;
+		std::unique_ptr<work_stealing_pool> _pool; // only for parallel merges
+		size_t _parallelMergeThreshold = 0;
+		int _minGallop = MIN_GALLOP; // galloping threshold, kept across the merges of a sort
 
         struct run {
 			Iterator begin; Iterator end;
@@ -196,8 +201,20 @@ namespace algorithms {
 
 	public:
 
+		powersort() = default;
+
+		explicit powersort(unsigned nThreads, size_t parallelMergeThreshold = 1 << 20)
+				: _pool(nThreads > 1 ? std::make_unique<work_stealing_pool>(nThreads) : nullptr),
+				  _parallelMergeThreshold(parallelMergeThreshold) {}
+
         void sort(Iterator begin, Iterator end) override {
-            _buffer.resize(end - begin + 2);
+            sort(begin, end, _ownScratch);
+        }
+
+        void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
+            _bufferSize = !uses_buffer(mergingMethod) ? 0 : halfSizeBuffer ? (end - begin + 1) / 2 : end - begin + 2;
+            _buffer = scratch.get(_bufferSize);
+            _minGallop = MIN_GALLOP;
             globalBegin = begin; globalEnd = end;
             if (usePowerIndexedStack)
                 power_sort(begin, end);
@@ -205,6 +222,68 @@ namespace algorithms {
                 power_sort_paper(begin, end);
         }
 
+		/**
+		 * sorts [begin,end), assuming that [begin,sortedEnd) is already sorted
+		 * (e.g., a sorted array with k = end-sortedEnd elements appended).
+		 * Only [sortedEnd,end) is sorted by powersort; it is then merged with the prefix
+		 * after trimming, so the elements of the prefix that are smaller than all new ones
+		 * are neither scanned nor moved: the cost is O(k log k) plus the (trimmed) merge.
+		 * The result is the same as for a stable sort of [begin,end).
+		 */
+		void sort_with_sorted_prefix(Iterator begin, Iterator sortedEnd, Iterator end) {
+			sort_with_sorted_prefix(begin, sortedEnd, end, _ownScratch);
+		}
+
+		void sort_with_sorted_prefix(Iterator begin, Iterator sortedEnd, Iterator end,
+		                             scratch_space<elem_t> &scratch) {
+			assert(begin <= sortedEnd && sortedEnd <= end);
+			sort(sortedEnd, end, scratch);
+			Iterator b[] = {begin, sortedEnd, end};
+			trim_runs(b);
+			Iterator l = b[0], m = sortedEnd, r = b[2];
+			if (l == m || m == r) return;
+			const size_t needed = merge_runs_buffer_size<mergingMethod>(m - l, r - m);
+			_bufferSize = halfSizeBuffer ? std::min<size_t>(needed, (r - l + 1) / 2) : needed;
+			_buffer = scratch.get(_bufferSize);
+			merge(l, m, r);
+		}
+
+		/**
+		 * sorts [begin,end), assuming that it was sorted before the elements in dirtyRanges
+		 * were changed; dirtyRanges must be disjoint and ordered from left to right.
+		 * The dirty elements are moved behind the clean ones (a stable partition of the part
+		 * right of the first dirty range), then sort_with_sorted_prefix is used.
+		 * The cost is O(n - d + k log k) for k dirty elements and d the begin of the first dirty range.
+		 * Dirty elements end up after clean elements that compare equal to them.
+		 */
+		void sort_dirty_ranges(Iterator begin, Iterator end,
+		                       const std::vector<std::pair<Iterator, Iterator>> &dirtyRanges) {
+			sort_dirty_ranges(begin, end, dirtyRanges, _ownScratch);
+		}
+
+		void sort_dirty_ranges(Iterator begin, Iterator end,
+		                       const std::vector<std::pair<Iterator, Iterator>> &dirtyRanges,
+		                       scratch_space<elem_t> &scratch) {
+			size_t k = 0;
+			for (const auto &range : dirtyRanges) {
+				assert(begin <= range.first && range.first <= range.second && range.second <= end);
+				assert(&range == &dirtyRanges.front() || (&range - 1)->second <= range.first);
+				k += range.second - range.first;
+			}
+			if (k == 0) return;
+			elem_t *dirty = scratch.get(k), *d = dirty;
+			Iterator out = dirtyRanges.front().first;
+			for (size_t i = 0; i < dirtyRanges.size(); ++i) {
+				d = std::uninitialized_move(dirtyRanges[i].first, dirtyRanges[i].second, d);
+				Iterator cleanEnd = i + 1 < dirtyRanges.size() ? dirtyRanges[i + 1].first : end;
+				out = std::move(dirtyRanges[i].second, cleanEnd, out);
+			}
+			assert(out == end - k);
+			std::move(dirty, dirty + k, out);
+			std::destroy(dirty, dirty + k);
+			sort_with_sorted_prefix(begin, out, end, scratch);
+		}
+
 
 		power_t node_power(size_t begin, size_t end,
 		                    size_t beginA, size_t beginB, size_t endB) {
@@ -223,6 +302,22 @@ namespace algorithms {
 		}
 
 
+		/** merges [l,m) and [m,r), in parallel if the merge is large and fits into the buffer */
+		void merge(Iterator l, Iterator m, Iterator r) {
+			const size_t n = r - l;
+			if (halfSizeBuffer && merge_runs_buffer_size<mergingMethod>(m - l, r - m) > _bufferSize) {
+				if (trimRuns) {
+					Iterator b[] = {l, m, r};
+					trim_runs(b);
+					l = b[0], r = b[2];
+				}
+				merge_runs_bounded_buffer(l, m, r, _buffer, _bufferSize);
+			} else if (_pool && n >= _parallelMergeThreshold && n <= _bufferSize)
+				parallel_merge_runs<trimRuns>(l, m, r, _buffer, *_pool);
+			else
+				merge_runs<mergingMethod, trimRuns>(l, m, r, _buffer, _minGallop);
+		}
+
 		/**
 		 * sorts [begin,end), assuming that [begin,leftRunEnd) and
 		 * [rightRunBegin,end) are sorted
@@ -240,7 +335,7 @@ namespace algorithms {
 			size_t lenA = runA.end - runA.begin;
 			if (lenA < minRunLen) {
 				runA.end = std::min(end, runA.begin + minRunLen);
-				insertionsort(runA.begin, runA.end, lenA);
+				small_sort<smallSortMethod>(runA.begin, runA.end, lenA);
 			}
 
 			while (runA.end < end) {
@@ -249,7 +344,7 @@ namespace algorithms {
 				size_t lenB = runB.end - runB.begin;
 				if (lenB < minRunLen) {
 					runB.end = std::min(end, runB.begin + minRunLen);
-					insertionsort(runB.begin, runB.end, lenB);
+					small_sort<smallSortMethod>(runB.begin, runB.end, lenB);
 				}
 				unsigned k = node_power(0, n,
 				                        (size_t) (runA.begin-begin),
@@ -258,7 +353,7 @@ namespace algorithms {
 				assert( k != top );
 				for (unsigned l = top; l > k; --l) {
 					if (runStack[l] == NULL_RUN) continue;
-					merge_runs<mergingMethod>(runStack[l].begin, runStack[l].end, runA.end, _buffer.begin());
+					merge(runStack[l].begin, runStack[l].end, runA.end);
 					runA.begin = runStack[l].begin;
 					runStack[l] = NULL_RUN;
 				}
@@ -270,7 +365,7 @@ namespace algorithms {
 			assert(runA.end == end);
 			for (unsigned l = top; l > 0; --l) {
 				if (runStack[l] != NULL_RUN)
-					merge_runs<mergingMethod>(runStack[l].begin, runStack[l].end, end, _buffer.begin());
+					merge(runStack[l].begin, runStack[l].end, end);
 			}
 		}
 
@@ -291,7 +386,7 @@ namespace algorithms {
             size_t lenA = runA.end - runA.begin;
             if (lenA < minRunLen) {
                 runA.end = std::min(end, runA.begin + minRunLen);
-                insertionsort(runA.begin, runA.end, lenA);
+                small_sort<smallSortMethod>(runA.begin, runA.end, lenA);
             }
             while (runA.end < end) {
                 run runB = {runA.end, extend_and_reverse_run_right(runA.end, end)};
@@ -299,7 +394,7 @@ namespace algorithms {
                 size_t lenB = runB.end - runB.begin;
                 if (lenB < minRunLen) {
                     runB.end = std::min(end, runB.begin + minRunLen);
-                    insertionsort(runB.begin, runB.end, lenB);
+                    small_sort<smallSortMethod>(runB.begin, runB.end, lenB);
                 }
                 runA.power = node_power(0, n,
                                         (size_t) (runA.begin-begin),
@@ -308,7 +403,7 @@ namespace algorithms {
                 // Invariant: powers on stack must be increasing from bottom to top
                 while (stack[top].power > runA.power) {
                     auto top_run = stack[top--]; // pop
-                    merge_runs<mergingMethod>(top_run.begin, runA.begin, runA.end, _buffer.begin());
+                    merge(top_run.begin, runA.begin, runA.end);
                     runA.begin = top_run.begin;
                 }
                 // store updated runA to be merged with runB at power k
@@ -318,16 +413,22 @@ namespace algorithms {
             assert(runA.end == end);
             while (top > 0) {
                 auto top_run = stack[top--]; // pop
-                merge_runs<mergingMethod>(top_run.begin, runA.begin, end, _buffer.begin());
+                merge(top_run.begin, runA.begin, end);
                 runA.begin = top_run.begin;
             }
         }
 
 
+        long long scratch_elements() const override { return _bufferSize; }
+
         std::string name() const override {
             return "PowerSort+minRunLen=" + std::to_string(minRunLen) +
                    "+onlyIncRuns=" + std::to_string(onlyIncreasingRuns) +
-                   "+mergingMethod=" + to_string(mergingMethod);
+                   "+mergingMethod=" + to_string(mergingMethod) +
+                   (trimRuns ? "+trimRuns" : "") +
+                   (halfSizeBuffer ? "+halfSizeBuffer" : "") +
+                   (smallSortMethod != INSERTIONSORT ? "+smallSort=" + to_string(smallSortMethod) : "") +
+                   (_pool ? "+threads=" + std::to_string(_pool->n_threads()) : "");
 
         }
         std::string full_name() const {
@@ -335,11 +436,56 @@ namespace algorithms {
                    "+onlyIncRuns=" + std::to_string(onlyIncreasingRuns) +
                    "+mergingMethod=" + to_string(mergingMethod) +
                    "+nodePowerImplementation=" + to_string(nodePowerImplementation) +
-                   "+powerIndex=" + std::to_string(usePowerIndexedStack);
+                   "+powerIndex=" + std::to_string(usePowerIndexedStack) +
+                   "+trimRuns=" + std::to_string(trimRuns) +
+                   "+halfSizeBuffer=" + std::to_string(halfSizeBuffer) +
+                   "+smallSort=" + to_string(smallSortMethod);
 
         }
 	};
 
+	/**
+	 * Powersort for inputs where only the last k elements are unsorted,
+	 * i.e., a sorted array with k elements appended (see powersort::sort_with_sorted_prefix).
+	 * Inputs with at most k elements are sorted entirely.
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename Iterator,
+			unsigned int minRunLen = 24,
+			merging_methods mergingMethod = merging_methods::COPY_SMALLER
+	>
+	class appended_powersort final : public sorter<Iterator> {
+	private:
+		using typename sorter<Iterator>::elem_t;
+		scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+		powersort<Iterator, minRunLen, mergingMethod> _powersort;
+		const size_t _k;
+
+	public:
+
+		explicit appended_powersort(size_t k) : _k(k) {}
+
+		void sort(Iterator begin, Iterator end) override {
+			sort(begin, end, _ownScratch);
+		}
+
+		void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
+			const size_t n = end - begin;
+			_powersort.sort_with_sorted_prefix(begin, end - std::min(_k, n), end, scratch);
+		}
+
+		long long scratch_elements() const override { return _powersort.scratch_elements(); }
+
+		std::string name() const override {
+			// inputs that do not report an unsorted suffix leave _k at SIZE_MAX
+			const std::string k = _k == std::numeric_limits<size_t>::max() ? "unknown" : std::to_string(_k);
+			return "AppendedPowerSort+k=" + k +
+			       "+minRunLen=" + std::to_string(minRunLen) +
+			       "+mergingMethod=" + to_string(mergingMethod);
+		}
+	};
+
 
 
 
@@ -6,11 +6,13 @@
 
 #include <cassert>
 #include <cmath>
+#include <memory>
 #include "../algorithms.h"
 #include "insertionsort.h"
 #include "merging.h"
 #include "merging_3way.h"
 #include "merging_multiway.h"
+#include "merging_parallel.h"
 #include "powersort.h"
 
 
@@ -107,12 +109,9 @@ namespace algorithms {
     power_t node_power4_clz(size_t begin, size_t end,
                              size_t beginA, size_t beginB, size_t endB) {
         size_t n = end - begin;
-        assert(n <= (1L << 31));
         unsigned long l2 = beginA + beginB - 2 * begin; // 2*l
         unsigned long r2 = beginB + endB - 2 * begin;   // 2*r
-        auto a = static_cast<unsigned int>((l2 << 30) / n);
-        auto b = static_cast<unsigned int>((r2 << 30) / n);
-        return (__builtin_clz(a ^ b)-1) / 2 + 1;
+        return (fraction_prefix_clz(n, l2, r2)-1) / 2 + 1;
     }
 
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
@@ -129,6 +128,13 @@ namespace algorithms {
      * a most-significant-bit trick;
      * otherwise a loop is used.
      * If onlyIncreasingRuns is true, only weakly increasing runs are picked up.
+     * If trimRuns is true, each merge first skips elements already in their final place (see trim_runs).
+     * If halfSizeBuffer is true, only ceil(n/2) elements of scratch space are used;
+     * merges that do not fit are done as 2-way merges with merge_runs_bounded_buffer.
+     * If constructed with nThreads > 1, merges of at least parallelMergeThreshold
+     * elements are done by nThreads threads (see merging_parallel.h).
+     * Single 2-way merges (at the end of the run stack) use twoWayMergingMethod,
+     * which needs at most r-l elements of buffer.
      *
      * @author Sebastian Wild (wild@liverpool.ac.uk)
      */
@@ -139,14 +145,21 @@ namespace algorithms {
             node_power4_implementations nodePowerImplementation = MOST_SIGNIFICANT_SET_BIT4 /** very little difference */,
             bool useParallelArraysForStack = false, /** very little difference*/
             bool useCheckFirstMergeLoop = true /** very little difference */,
-            bool useSpecialized3wayMerge = true /** no huge difference, but no detriment */
+            bool useSpecialized3wayMerge = true /** no huge difference, but no detriment */,
+            bool trimRuns = false,
+            bool halfSizeBuffer = false,
+            merging_methods twoWayMergingMethod = default_merging_method<Iterator>
     >
     class powersort_4way final : public sorter<Iterator> {
     private:
         using typename sorter<Iterator>::elem_t;
         using typename sorter<Iterator>::diff_t;
-        std::vector<elem_t> _buffer;
+        scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+        elem_t *_buffer = nullptr;
+        size_t _bufferSize = 0;
         Iterator globalBegin, globalEnd;
+        std::unique_ptr<work_stealing_pool> _pool; // only for parallel merges
+        size_t _parallelMergeThreshold = 0;
 
         struct run_begin_n_power{
             Iterator begin;
@@ -168,8 +181,19 @@ namespace algorithms {
 
     public:
 
+        powersort_4way() = default;
+
+        explicit powersort_4way(unsigned nThreads, size_t parallelMergeThreshold = 1 << 20)
+                : _pool(nThreads > 1 ? std::make_unique<work_stealing_pool>(nThreads) : nullptr),
+                  _parallelMergeThreshold(parallelMergeThreshold) {}
+
         void sort(Iterator begin, Iterator end) override {
-            _buffer.resize(end - begin + 4);
+            sort(begin, end, _ownScratch);
+        }
+
+        void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
+            _bufferSize = halfSizeBuffer ? (end - begin + 1) / 2 : end - begin + 4;
+            _buffer = scratch.get(_bufferSize);
             globalBegin = begin;
             globalEnd = end;
             if (useParallelArraysForStack)
@@ -269,23 +293,66 @@ namespace algorithms {
 
 
 
+        bool merge_in_parallel(Iterator l, Iterator r) const {
+            return _pool && (size_t) (r - l) >= _parallelMergeThreshold && (size_t) (r - l) <= _bufferSize;
+        }
+
+        /** true if a multiway merge of [l,r) might need more than the buffer (with up to 4 sentinels) */
+        bool exceeds_buffer(Iterator l, Iterator r) const {
+            return halfSizeBuffer && (size_t) (r - l) + 4 > _bufferSize;
+        }
+
+        void merge2(Iterator l, Iterator m, Iterator r) {
+            if (exceeds_buffer(l, r)) {
+                if (trimRuns) {
+                    Iterator b[] = {l, m, r};
+                    trim_runs(b);
+                    l = b[0], r = b[2];
+                }
+                merge_runs_bounded_buffer(l, m, r, _buffer, _bufferSize);
+            } else if (merge_in_parallel(l, r))
+                parallel_merge_runs<trimRuns>(l, m, r, _buffer, *_pool);
+            else
+                merge_runs<twoWayMergingMethod, trimRuns>(l, m, r, _buffer);
+        }
+
+        void merge3(Iterator l, Iterator g1, Iterator g2, Iterator r) {
+            if (exceeds_buffer(l, r)) {
+                merge2(l, g1, g2);
+                merge2(l, g2, r);
+            } else if (merge_in_parallel(l, r))
+                parallel_merge_3runs<trimRuns>(l, g1, g2, r, _buffer, *_pool);
+            else if (useSpecialized3wayMerge)
+                merge_3runs<mergingMethod, trimRuns, twoWayMergingMethod>(l, g1, g2, r, _buffer);
+            else
+                merge_4runs<mergingMethod, trimRuns, twoWayMergingMethod>(l, g1, g2, r, r, _buffer);
+        }
+
+        void merge4(Iterator l, Iterator g1, Iterator g2, Iterator g3, Iterator r) {
+            if (exceeds_buffer(l, r)) {
+                merge2(l, g1, g2);
+                merge2(g2, g3, r);
+                merge2(l, g2, r);
+            } else if (merge_in_parallel(l, r))
+                parallel_merge_4runs<trimRuns>(l, g1, g2, g3, r, _buffer, *_pool);
+            else
+                merge_4runs<mergingMethod, trimRuns, twoWayMergingMethod>(l, g1, g2, g3, r, _buffer);
+        }
+
         void merge_loop_check_first(run_begin_n_power * &top_of_stack, run_n_power &runA) {
             int nRunsSamePower = 1;
             while((top_of_stack - nRunsSamePower)->power == top_of_stack->power)
                 ++nRunsSamePower;
             if (nRunsSamePower == 1) { // 2way
                 Iterator g[] = {top_of_stack->begin};
-                merge_runs<COPY_BOTH>(g[0], runA.begin, runA.end, _buffer.begin());
+                merge2(g[0], runA.begin, runA.end);
                 runA.begin = g[0];
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges2; mergeCost2 += runA.end - runA.begin;
 #endif
             } else if (nRunsSamePower == 2) { // 3way
                 Iterator g[] = {(top_of_stack-1)->begin, top_of_stack->begin};
-                if (useSpecialized3wayMerge)
-                    merge_3runs<mergingMethod>(g[0], g[1], runA.begin, runA.end, _buffer.begin());
-                else
-                    merge_4runs<mergingMethod>(g[0], g[1], runA.begin, runA.end, runA.end, _buffer.begin());
+                merge3(g[0], g[1], runA.begin, runA.end);
                 runA.begin = g[0];
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges3; mergeCost3 += runA.end - runA.begin;
@@ -293,7 +360,7 @@ namespace algorithms {
             } else { // 4way
                 assert(nRunsSamePower == 3);
                 Iterator g[] = {(top_of_stack-2)->begin, (top_of_stack-1)->begin, top_of_stack->begin};
-                merge_4runs<mergingMethod>(g[0], g[1], g[2], runA.begin, runA.end, _buffer.begin());
+                merge4(g[0], g[1], g[2], runA.begin, runA.end);
                 runA.begin = g[0];
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges4; mergeCost4 += runA.end - runA.begin;
@@ -309,17 +376,14 @@ namespace algorithms {
             g[2] = topRun.begin;
             if (top_of_stack->power != topRun.power) { // 2way
                 // use specialized method (had no measurable effect for rp ...)
-                merge_runs<COPY_BOTH>(g[2], runA.begin, runA.end, _buffer.begin());
+                merge2(g[2], runA.begin, runA.end);
                 runA.begin = g[2];
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges2; mergeCost2 += runA.end - runA.begin;
 #endif
             } else if ((top_of_stack-1)->power != topRun.power) { // 3way
                 g[1] = (top_of_stack--)->begin; // pop
-                if (useSpecialized3wayMerge)
-                    merge_3runs<mergingMethod>(g[1], g[2], runA.begin, runA.end, _buffer.begin());
-                else
-                    merge_4runs<mergingMethod>(g[1], g[2], runA.begin, runA.end, runA.end, _buffer.begin());
+                merge3(g[1], g[2], runA.begin, runA.end);
                 runA.begin = g[1];
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges3; mergeCost3 += runA.end - runA.begin;
@@ -327,7 +391,7 @@ namespace algorithms {
             } else { // 4way
                 g[1] = (top_of_stack--)->begin; // pop
                 g[0] = (top_of_stack--)->begin; // pop
-                merge_4runs<mergingMethod>(g[0], g[1], g[2], runA.begin, runA.end, _buffer.begin());
+                merge4(g[0], g[1], g[2], runA.begin, runA.end);
                 runA.begin = g[0];
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges4; mergeCost4 += runA.end - runA.begin;
@@ -343,12 +407,8 @@ namespace algorithms {
             switch (nRuns % 3) {
                 case 0: // merge topmost 3 runs
                     assert(nRuns >= 3);
-                    if (useSpecialized3wayMerge)
-                        merge_3runs<mergingMethod>((top_of_stack-1)->begin, top_of_stack->begin,
-                                                   runA.begin, runA.end, _buffer.begin());
-                    else
-                        merge_4runs<mergingMethod>((top_of_stack-1)->begin, top_of_stack->begin,
-                                                     runA.begin, runA.end, runA.end, _buffer.begin());
+                    merge3((top_of_stack-1)->begin, top_of_stack->begin,
+                           runA.begin, runA.end);
                     runA.begin = (top_of_stack-1)->begin;
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                     ++nMerges3;
@@ -357,7 +417,7 @@ namespace algorithms {
                     top_of_stack -= 2;
                     break;
                 case 2: // merge topmost 2 runs
-                    merge_runs<COPY_BOTH>(top_of_stack->begin, runA.begin, runA.end, _buffer.begin());
+                    merge2(top_of_stack->begin, runA.begin, runA.end);
                     runA.begin = top_of_stack->begin;
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                     ++nMerges2;
@@ -371,8 +431,8 @@ namespace algorithms {
             assert(((top_of_stack - begin_of_stack) % 3) == 0);
             // merge remaining stack 4way each
             while (top_of_stack > begin_of_stack) {
-                merge_4runs<mergingMethod>((top_of_stack-2)->begin, (top_of_stack-1)->begin,
-                                                 top_of_stack->begin, runA.begin, runA.end, _buffer.begin());
+                merge4((top_of_stack-2)->begin, (top_of_stack-1)->begin,
+                       top_of_stack->begin, runA.begin, runA.end);
                 runA.begin = (top_of_stack-2)->begin;
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges4;
@@ -469,17 +529,14 @@ namespace algorithms {
                 ++nRunsSamePower;
             if (nRunsSamePower == 1) { // 2way
                 Iterator g[] = {*top_of_stack_run};
-                merge_runs<COPY_BOTH>(g[0], runA.begin, runA.end, _buffer.begin());
+                merge2(g[0], runA.begin, runA.end);
                 runA.begin = g[0];
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges2; mergeCost2 += runA.end - runA.begin;
 #endif
             } else if (nRunsSamePower == 2) { // 3way
                 Iterator g[] = {*(top_of_stack_run - 1), *top_of_stack_run};
-                if (useSpecialized3wayMerge)
-                    merge_3runs<mergingMethod>(g[0], g[1], runA.begin, runA.end, _buffer.begin());
-                else
-                    merge_4runs<mergingMethod>(g[0], g[1], runA.begin, runA.end, runA.end, _buffer.begin());
+                merge3(g[0], g[1], runA.begin, runA.end);
                 runA.begin = g[0];
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges3; mergeCost3 += runA.end - runA.begin;
@@ -487,7 +544,7 @@ namespace algorithms {
             } else { // 4way
                 assert(nRunsSamePower == 3);
                 Iterator g[] = {*(top_of_stack_run - 2), *(top_of_stack_run - 1), *top_of_stack_run};
-                merge_4runs<mergingMethod>(g[0], g[1], g[2], runA.begin, runA.end, _buffer.begin());
+                merge4(g[0], g[1], g[2], runA.begin, runA.end);
                 runA.begin = g[0];
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges4; mergeCost4 += runA.end - runA.begin;
@@ -505,12 +562,8 @@ namespace algorithms {
             switch (nRuns % 3) {
                 case 0: // merge topmost 3 runs
                     assert(nRuns >= 3);
-                    if (useSpecialized3wayMerge)
-                        merge_3runs<mergingMethod>(*(top_of_stack_run-1), *top_of_stack_run,
-                                                   runA.begin, runA.end, _buffer.begin());
-                    else
-                        merge_4runs<mergingMethod>(*(top_of_stack_run-1), *top_of_stack_run,
-                                                   runA.begin, runA.end, runA.end, _buffer.begin());
+                    merge3(*(top_of_stack_run-1), *top_of_stack_run,
+                           runA.begin, runA.end);
                     runA.begin = *(top_of_stack_run-1);
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                     ++nMerges3;
@@ -519,7 +572,7 @@ namespace algorithms {
                     top_of_stack_run -= 2;
                     break;
                 case 2: // merge topmost 2 runs
-                    merge_runs<COPY_BOTH>(*top_of_stack_run, runA.begin, runA.end, _buffer.begin());
+                    merge2(*top_of_stack_run, runA.begin, runA.end);
                     runA.begin = *top_of_stack_run;
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                     ++nMerges2;
@@ -533,8 +586,8 @@ namespace algorithms {
             assert(((top_of_stack_run - begin_of_stack_run) % 3) == 0);
             // merge remaining stack 4way each
             while (top_of_stack_run > begin_of_stack_run) {
-                merge_4runs<mergingMethod>(*(top_of_stack_run-2), *(top_of_stack_run-1),
-                                           *top_of_stack_run, runA.begin, runA.end, _buffer.begin());
+                merge4(*(top_of_stack_run-2), *(top_of_stack_run-1),
+                       *top_of_stack_run, runA.begin, runA.end);
                 runA.begin = *(top_of_stack_run-2);
 #ifdef PRINT_MERGES_AND_MERGECOST_PER_K
                 ++nMerges4;
@@ -544,11 +597,16 @@ namespace algorithms {
             }
         }
 
+        long long scratch_elements() const override { return _bufferSize; }
+
         std::string name() const override {
             return "PowerSort4Way+minRunLen=" + std::to_string(minRunLen) +
                    "+mergeMethod=" + to_string(mergingMethod) +
-                   "+onlyIncRuns=" + std::to_string(onlyIncreasingRuns)
-                   ;
+                   "+onlyIncRuns=" + std::to_string(onlyIncreasingRuns) +
+                   (trimRuns ? "+trimRuns" : "") +
+                   (halfSizeBuffer ? "+halfSizeBuffer" : "") +
+                   (twoWayMergingMethod != COPY_BOTH ? "+twoWayMergeMethod=" + to_string(twoWayMergingMethod) : "") +
+                   (_pool ? "+threads=" + std::to_string(_pool->n_threads()) : "");
         }
 
         std::string full_name() const {
@@ -558,7 +616,10 @@ namespace algorithms {
                    "+onlyIncRuns=" + std::to_string(onlyIncreasingRuns) +
                    +"+useParallelArraysForStack=" + std::to_string(useParallelArraysForStack) +
                    "+useSpecialized3wayMerge=" + std::to_string(useSpecialized3wayMerge) +
-                   "+useCheckFirstMergeLoop=" + std::to_string(useCheckFirstMergeLoop);
+                   "+useCheckFirstMergeLoop=" + std::to_string(useCheckFirstMergeLoop) +
+                   "+trimRuns=" + std::to_string(trimRuns) +
+                   "+halfSizeBuffer=" + std::to_string(halfSizeBuffer) +
+                   "+twoWayMergeMethod=" + to_string(twoWayMergingMethod);
         }
     };
 
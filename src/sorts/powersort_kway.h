@@ -0,0 +1,168 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_POWERSORT_KWAY_H
+#define MERGESORTS_POWERSORT_KWAY_H
+
+#include <cassert>
+#include <string>
+#include "../algorithms.h"
+#include "merging.h"
+#include "merging_kway.h"
+#include "powersort.h"
+#include "small_sort.h"
+
+namespace algorithms {
+
+	/**
+	 * node power of the boundary between runs [beginA,beginB) and [beginB,endB) in base K
+	 * (a power of two): the number of leading base-K digits the midpoints of the runs
+	 * (relative to [begin,end)) have in common, plus one.
+	 * For K = 2, this is node_power_clz; for K = 4, node_power4_clz.
+	 */
+	template<unsigned K>
+	power_t node_power_kway_clz(size_t begin, size_t end,
+	                            size_t beginA, size_t beginB, size_t endB) {
+		static_assert(K >= 2 && (K & (K - 1)) == 0, "K must be a power of two");
+		constexpr unsigned bitsPerDigit = __builtin_ctz(K);
+		size_t n = end - begin;
+		unsigned long l2 = beginA + beginB - 2 * begin; // 2*l
+		unsigned long r2 = beginB + endB - 2 * begin;   // 2*r
+		return (fraction_prefix_clz(n, l2, r2) - 1) / bitsPerDigit + 1;
+	}
+
+	/**
+	 * K-way Powersort, generalizing powersort_4way to any power of two K <= MAX_MERGE_ARITY:
+	 * node powers are computed in base K and all (up to K) runs of equal power on the stack
+	 * are merged at once by merge_kruns (with a loser tree).
+	 * Once all runs are known, merge_down merges so that all merges but the first are K-way.
+	 *
+	 * Natural runs are extended to minRunLen with smallSortMethod if needed;
+	 * merges of only two runs use twoWayMergingMethod.
+	 * Needs n elements of scratch space.
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename Iterator,
+			unsigned K = 8,
+			unsigned int minRunLen = 24,
+			merging_methods twoWayMergingMethod = default_merging_method<Iterator>,
+			small_sort_methods smallSortMethod = INSERTIONSORT
+	>
+	class powersort_kway final : public sorter<Iterator> {
+		static_assert(K >= 2 && K <= MAX_MERGE_ARITY && (K & (K - 1)) == 0,
+		              "K must be a power of two of at most MAX_MERGE_ARITY");
+	private:
+		using typename sorter<Iterator>::elem_t;
+		scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+		elem_t *_buffer = nullptr;
+		size_t _bufferSize = 0;
+
+		struct run_begin_n_power {
+			Iterator begin;
+			power_t power = 0;
+		};
+
+		struct run_n_power {
+			Iterator begin;
+			Iterator end;
+			power_t power = 0;
+		};
+
+	public:
+
+		void sort(Iterator begin, Iterator end) override {
+			sort(begin, end, _ownScratch);
+		}
+
+		void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
+			_bufferSize = end - begin + 2; // 2-way merging methods with sentinels need 2 more
+			_buffer = scratch.get(_bufferSize);
+			power_sort(begin, end);
+		}
+
+		long long scratch_elements() const override { return _bufferSize; }
+
+		std::string name() const override {
+			return "PowerSortKWay+K=" + std::to_string(K) +
+			       "+minRunLen=" + std::to_string(minRunLen) +
+			       "+twoWayMergeMethod=" + to_string(twoWayMergingMethod) +
+			       (smallSortMethod != INSERTIONSORT ? "+smallSort=" + to_string(smallSortMethod) : "");
+		}
+
+	private:
+
+		/** extends the run starting at begin to minRunLen (if possible) and returns its end */
+		Iterator next_run(Iterator begin, Iterator end) {
+			Iterator runEnd = extend_and_reverse_run_right(begin, end);
+			size_t len = runEnd - begin;
+			if (len < minRunLen) {
+				runEnd = std::min(end, begin + minRunLen);
+				small_sort<smallSortMethod>(begin, runEnd, len);
+			}
+			return runEnd;
+		}
+
+		void power_sort(Iterator begin, Iterator end) {
+			const size_t n = end - begin;
+			constexpr unsigned bitsPerDigit = __builtin_ctz(K);
+			// at most K-1 runs per power, and powers are at most floor_log2(n)/bitsPerDigit + 1
+			const unsigned maxStackHeight = (K - 1) * (floor_log2(n) / bitsPerDigit + 1) + 2;
+			run_begin_n_power stack[maxStackHeight];
+			run_begin_n_power *top_of_stack = stack; // keep power-0 entry in stack[0] as sentinel
+			*top_of_stack = {begin, 0};
+
+			run_n_power runA = {begin, next_run(begin, end), 0};
+			while (runA.end < end) {
+				Iterator runBEnd = next_run(runA.end, end);
+				runA.power = node_power_kway_clz<K>(0, n,
+				                                    (size_t) (runA.begin - begin),
+				                                    (size_t) (runA.end - begin),
+				                                    (size_t) (runBEnd - begin));
+				// Invariant: powers on stack must be *weakly* increasing from bottom to top
+				while (top_of_stack->power > runA.power) {
+					unsigned nRunsSamePower = 1;
+					while ((top_of_stack - nRunsSamePower)->power == top_of_stack->power)
+						++nRunsSamePower;
+					assert(nRunsSamePower < K);
+					merge_top(top_of_stack, nRunsSamePower, runA);
+				}
+				assert(top_of_stack + 1 < stack + maxStackHeight);
+				*(++top_of_stack) = {runA.begin, runA.power}; // push
+				runA = {runA.end, runBEnd, 0};
+			}
+			assert(runA.end == end);
+			merge_down(stack, top_of_stack, runA);
+			assert(top_of_stack == stack);
+		}
+
+		/** merges the topmost nRuns runs of the stack with runA and pops them */
+		void merge_top(run_begin_n_power *&top_of_stack, unsigned nRuns, run_n_power &runA) {
+			if (nRuns == 1) {
+				merge_runs<twoWayMergingMethod>(top_of_stack->begin, runA.begin, runA.end, _buffer);
+			} else {
+				Iterator g[K + 1];
+				for (unsigned i = 0; i < nRuns; ++i) g[i] = (top_of_stack - (nRuns - 1 - i))->begin;
+				g[nRuns] = runA.begin;
+				g[nRuns + 1] = runA.end;
+				merge_kruns<K>(g, nRuns + 1, _buffer);
+			}
+			top_of_stack -= nRuns;
+			runA.begin = (top_of_stack + 1)->begin;
+		}
+
+		void merge_down(run_begin_n_power *begin_of_stack, run_begin_n_power *&top_of_stack, run_n_power &runA) {
+			// we have the entire stack of runs, so instead of following exactly the powersort rule, we can
+			// be slightly more clever and make sure we have K-way merges all the way through except the first merge:
+			// with (K-1)j + 1 runs, repeatedly merging K and putting the result back gives K-way merges throughout.
+			auto nRuns = top_of_stack - begin_of_stack + 1; // stack and runA
+			if (nRuns == 1) return;
+			unsigned nFirst = (nRuns - 1) % (K - 1); // merge topmost nFirst stack runs with runA first
+			if (nFirst > 0) merge_top(top_of_stack, nFirst, runA);
+			assert((top_of_stack - begin_of_stack) % (K - 1) == 0);
+			while (top_of_stack > begin_of_stack) merge_top(top_of_stack, K - 1, runA);
+		}
+	};
+
+}
+
+#endif //MERGESORTS_POWERSORT_KWAY_H
@@ -0,0 +1,262 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_POWERSORT_PARALLEL_H
+#define MERGESORTS_POWERSORT_PARALLEL_H
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+#include <vector>
+#include "../algorithms.h"
+#include "insertionsort.h"
+#include "merging.h"
+#include "merging_parallel.h"
+#include "powersort.h"
+#include "work_stealing_pool.h"
+
+namespace algorithms {
+
+	/**
+	 * Multi-threaded Powersort.
+	 *
+	 * Runs are detected (and extended to minRunLen) as in powersort, but concurrently
+	 * in chunks (see find_runs). Then the
+	 * merge tree is computed from the node powers upfront by replaying the
+	 * stack-based merge rule of powersort::power_sort_paper. Hence we obtain the
+	 * very same merges (and so the same stable result) as the sequential version.
+	 * Independent subtrees of the merge tree are then merged as tasks of a
+	 * work-stealing thread pool; subtrees with fewer than minTaskSize elements are
+	 * merged by the thread that reaches them.
+	 * The topmost merges are too few to keep all threads busy; merges of at least
+	 * parallelMergeThreshold elements are hence themselves split (see merging_parallel.h).
+	 *
+	 * Every merge uses its own region of the shared buffer, so mergingMethod
+	 * can be any of the 2-way merging methods, including those with sentinels.
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename Iterator,
+			unsigned int minRunLen = 24,
+			merging_methods mergingMethod = merging_methods::COPY_BOTH
+	>
+	class parallel_powersort final : public sorter<Iterator> {
+	private:
+		using typename sorter<Iterator>::elem_t;
+		using typename sorter<Iterator>::diff_t;
+		scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+		elem_t *_buffer = nullptr;
+		size_t _bufferSize = 0;
+		work_stealing_pool _pool;
+		const size_t _minTaskSize, _parallelMergeThreshold;
+		Iterator globalBegin, globalEnd;
+
+		/** node of the merge tree; leaves are the runs */
+		struct merge_node {
+			Iterator begin, mid, end; // merges [begin,mid) and [mid,end)
+			int left, right; // children; -1 for leaves
+			int firstRun; // index of leftmost run in subtree
+		};
+		std::vector<merge_node> _tree;
+		std::vector<Iterator> _runBoundaries;
+
+		struct run {
+			Iterator begin, naturalEnd, end; // [begin,naturalEnd) is a natural run, extended to [begin,end)
+			bool descending;
+		};
+		std::vector<run> _runs;
+		std::vector<Iterator> _chunkBoundaries;
+		std::vector<Iterator> _increasingPrefixEnd, _decreasingPrefixEnd; // per chunk
+		std::vector<std::vector<run>> _chains; // runs found from the left end of each chunk
+
+	public:
+
+		explicit parallel_powersort(unsigned nThreads = std::thread::hardware_concurrency(),
+		                            size_t minTaskSize = 1 << 15,
+		                            size_t parallelMergeThreshold = 1 << 20)
+				: _pool(nThreads), _minTaskSize(minTaskSize), _parallelMergeThreshold(parallelMergeThreshold) {}
+
+		void sort(Iterator begin, Iterator end) override {
+			sort(begin, end, _ownScratch);
+		}
+
+		void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override {
+			globalBegin = begin;
+			find_runs(begin, end);
+			const int nRuns = _runBoundaries.size() - 1;
+			if (nRuns <= 1) return;
+			// two extra slots per run suffice for merging methods with sentinels
+			_bufferSize = end - begin + 2 * nRuns;
+			_buffer = scratch.get(_bufferSize);
+			int root = build_merge_tree(begin, end);
+			merge_subtree(root);
+		}
+
+		/**
+		 * Collects the runs as powersort would find them:
+		 * natural runs (descending ones reversed) extended to minRunLen.
+		 *
+		 * Run detection starting at a given position only reads elements to the right of it,
+		 * and reversing / extending a run only writes to positions left of the next run.
+		 * We can hence find runs in chunks concurrently:
+		 * 1. for each chunk, find the maximal weakly increasing and strictly decreasing prefixes;
+		 *    with those, the end of a natural run crossing chunk boundaries needs O(1) time per chunk,
+		 * 2. for each chunk, find the chain of runs starting at the chunk's left end,
+		 * 3. stitch the chains: follow the runs from begin; whenever the last run ends in chunk c at
+		 *    a position that is not on chunk c's chain, find runs serially until we hit the chain again,
+		 * 4. reverse descending runs and extend short runs to minRunLen, concurrently for groups of runs.
+		 * The resulting runs are exactly those of a left-to-right scan.
+		 */
+		void find_runs(Iterator begin, Iterator end) {
+			globalEnd = end;
+			const size_t n = end - begin;
+			const size_t nChunks = std::max<size_t>(1,
+					std::min<size_t>(4 * _pool.n_threads(), n / std::max<size_t>(_minTaskSize, 2)));
+			_chunkBoundaries.resize(nChunks + 1);
+			for (size_t c = 0; c <= nChunks; ++c) _chunkBoundaries[c] = begin + (n * c) / nChunks;
+			_increasingPrefixEnd.resize(nChunks);
+			_decreasingPrefixEnd.resize(nChunks);
+			_pool.parallel_for(nChunks, [this](size_t c) {
+				Iterator chunkBegin = _chunkBoundaries[c], chunkEnd = _chunkBoundaries[c + 1];
+				_increasingPrefixEnd[c] = weaklyIncreasingPrefix(chunkBegin, chunkEnd);
+				_decreasingPrefixEnd[c] = strictlyDecreasingPrefix(chunkBegin, chunkEnd);
+			});
+			_chains.resize(nChunks);
+			_pool.parallel_for(nChunks, [this](size_t c) {
+				_chains[c].clear();
+				for (Iterator runBegin = _chunkBoundaries[c]; runBegin < _chunkBoundaries[c + 1]; ) {
+					_chains[c].push_back(find_run(runBegin, c));
+					runBegin = _chains[c].back().end;
+				}
+			});
+			// stitch chains
+			_runs.clear();
+			Iterator runBegin = begin;
+			for (size_t c = 0; c < nChunks; ++c) {
+				auto &chain = _chains[c];
+				while (runBegin < _chunkBoundaries[c + 1]) {
+					auto onChain = std::lower_bound(chain.begin(), chain.end(), runBegin,
+					                                [](const run &r, Iterator pos) { return r.begin < pos; });
+					if (onChain != chain.end() && onChain->begin == runBegin) {
+						_runs.insert(_runs.end(), onChain, chain.end());
+						runBegin = chain.back().end;
+					} else {
+						_runs.push_back(find_run(runBegin, c));
+						runBegin = _runs.back().end;
+					}
+				}
+			}
+			assert(runBegin == end);
+			const size_t nRuns = _runs.size();
+			_pool.parallel_for(nChunks, [this, nRuns, nChunks](size_t c) {
+				for (size_t i = (nRuns * c) / nChunks; i < (nRuns * (c + 1)) / nChunks; ++i) {
+					const run &r = _runs[i];
+					if (r.descending) std::reverse(r.begin, r.naturalEnd);
+					if (r.naturalEnd < r.end)
+						insertionsort(r.begin, r.end, r.naturalEnd - r.begin);
+				}
+			});
+			_runBoundaries.clear();
+			_runBoundaries.push_back(begin);
+			for (const run &r : _runs) _runBoundaries.push_back(r.end);
+		}
+
+		/** boundaries of the runs found by the last call to find_runs */
+		const std::vector<Iterator> &run_boundaries() const { return _runBoundaries; }
+
+		/**
+		 * Finds (without modifying anything) the run powersort would start at runBegin,
+		 * which lies in chunk c, using the prefix ends of subsequent chunks.
+		 */
+		run find_run(Iterator runBegin, size_t c) const {
+			run r {runBegin, globalEnd, globalEnd, false};
+			if (runBegin + 1 < globalEnd) {
+				r.descending = *runBegin > *(runBegin + 1);
+				Iterator chunkEnd = _chunkBoundaries[c + 1];
+				r.naturalEnd = r.descending ? strictlyDecreasingPrefix(runBegin, chunkEnd)
+				                            : weaklyIncreasingPrefix(runBegin, chunkEnd);
+				// continue into next chunks while the run covers them entirely
+				while (r.naturalEnd == _chunkBoundaries[c + 1] && r.naturalEnd < globalEnd) {
+					Iterator e = r.naturalEnd;
+					if (r.descending ? !(*(e - 1) > *e) : !(*(e - 1) <= *e)) break;
+					++c;
+					r.naturalEnd = r.descending ? _decreasingPrefixEnd[c] : _increasingPrefixEnd[c];
+				}
+			}
+			size_t len = r.naturalEnd - runBegin;
+			if (len < minRunLen)
+				r.end = globalEnd - runBegin <= minRunLen ? globalEnd : runBegin + minRunLen;
+			else
+				r.end = r.naturalEnd;
+			return r;
+		}
+
+		/**
+		 * Builds the merge tree from _runBoundaries, mimicking the stack of
+		 * powersort::power_sort_paper; returns the index of the root.
+		 */
+		int build_merge_tree(Iterator begin, Iterator end) {
+			const size_t n = end - begin;
+			const int nRuns = _runBoundaries.size() - 1;
+			_tree.clear();
+			_tree.reserve(2 * nRuns - 1);
+			for (int i = 0; i < nRuns; ++i)
+				_tree.push_back({_runBoundaries[i], _runBoundaries[i + 1], _runBoundaries[i + 1], -1, -1, i});
+			struct stack_entry { int node; power_t power; };
+			std::vector<stack_entry> stack;
+			stack.reserve(floor_log2(n) + 2);
+			auto merge = [this](int left, int right) {
+				_tree.push_back({_tree[left].begin, _tree[right].begin, _tree[right].end,
+				                 left, right, _tree[left].firstRun});
+				return (int) _tree.size() - 1;
+			};
+			int runA = 0;
+			for (int b = 1; b < nRuns; ++b) {
+				power_t power = node_power_clz(0, n,
+				                               (size_t) (_tree[runA].begin - begin),
+				                               (size_t) (_runBoundaries[b] - begin),
+				                               (size_t) (_runBoundaries[b + 1] - begin));
+				while (!stack.empty() && stack.back().power > power) {
+					runA = merge(stack.back().node, runA);
+					stack.pop_back();
+				}
+				stack.push_back({runA, power});
+				runA = b;
+			}
+			while (!stack.empty()) {
+				runA = merge(stack.back().node, runA);
+				stack.pop_back();
+			}
+			return runA;
+		}
+
+		void merge_subtree(int i) {
+			const merge_node &node = _tree[i];
+			if (node.left < 0) return; // leaf
+			if (_pool.n_threads() > 1 && (size_t) (node.end - node.begin) >= _minTaskSize) {
+				work_stealing_pool::task_group children;
+				_pool.spawn(children, [this, &node] { merge_subtree(node.left); });
+				merge_subtree(node.right);
+				_pool.wait(children);
+			} else {
+				merge_subtree(node.left);
+				merge_subtree(node.right);
+			}
+			auto B = _buffer + ((node.begin - globalBegin) + 2 * node.firstRun);
+			if (_pool.n_threads() > 1 && (size_t) (node.end - node.begin) >= _parallelMergeThreshold)
+				parallel_merge_runs(node.begin, node.mid, node.end, B, _pool);
+			else
+				merge_runs<mergingMethod>(node.begin, node.mid, node.end, B);
+		}
+
+		long long scratch_elements() const override { return _bufferSize; }
+
+		std::string name() const override {
+			return "ParallelPowerSort+threads=" + std::to_string(_pool.n_threads()) +
+			       "+minRunLen=" + std::to_string(minRunLen) +
+			       "+mergingMethod=" + to_string(mergingMethod);
+		}
+	};
+
+}
+
+#endif //MERGESORTS_POWERSORT_PARALLEL_H
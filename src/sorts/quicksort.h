@@ -114,6 +114,8 @@ namespace algorithms {
 			quick_sort(i+1, end);
 		}
 
+		long long scratch_elements() const override { return 0; }
+
 		std::string name() const override {
 			return "QuickSort+iscutoff=" + std::to_string(insertionsortThreshold) +
 			       "+ninthercutiff=" + std::to_string(nintherThreshold) +
@@ -0,0 +1,130 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_RUN_DETECTION_SIMD_H
+#define MERGESORTS_RUN_DETECTION_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MERGESORTS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace algorithms {
+
+	/**
+	 * Vectorized scans for the end of weakly increasing and strictly decreasing runs
+	 * in arrays of 32- and 64-bit signed integers.
+	 *
+	 * A vector of adjacent pairs (a[i],a[i+1]) is compared at once by two unaligned loads
+	 * at offsets 0 and 1; a movemask of the comparison gives the first pair that ends the run.
+	 * AVX2 (8 resp. 4 pairs per comparison) or SSE4.2 (4 resp. 2 pairs) is chosen at runtime,
+	 * independent of the flags the code is compiled with.
+	 */
+	namespace simd {
+
+		/** true for Iterator = T* with T a 32- or 64-bit signed integer */
+		template<typename Iterator>
+		struct vectorizable : std::false_type {};
+
+		template<typename T>
+		struct vectorizable<T *> : std::bool_constant<
+				std::is_integral<T>::value && std::is_signed<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)> {};
+
+		/** whether pair (x,y) ends a run: x > y for weakly increasing, !(x > y) for strictly decreasing */
+		template<bool decreasing, typename T>
+		inline bool ends_run(const T &x, const T &y) {
+			return decreasing ? !(x > y) : x > y;
+		}
+
+		/** returns the smallest i with ends_run(a[i], a[i+1]), or n-1 if there is none; n >= 1 */
+		template<bool decreasing, typename T>
+		size_t first_run_end_scalar(const T *a, size_t n) {
+			size_t i = 0;
+			while (i + 1 < n && !ends_run<decreasing>(a[i], a[i + 1])) ++i;
+			return i;
+		}
+
+#ifdef MERGESORTS_X86_SIMD
+
+		template<bool decreasing, typename T>
+		__attribute__((target("avx2")))
+		size_t first_run_end_avx2(const T *a, size_t n) {
+			constexpr size_t lanes = 32 / sizeof(T);
+			size_t i = 0;
+			for (; i + lanes < n; i += lanes) {
+				const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+				const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 1));
+				unsigned mask;
+				if constexpr (sizeof(T) == 4)
+					mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, y)));
+				else
+					mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(x, y)));
+				if constexpr (decreasing) mask ^= (1u << lanes) - 1;
+				if (mask) return i + __builtin_ctz(mask);
+			}
+			return i + first_run_end_scalar<decreasing>(a + i, n - i);
+		}
+
+		template<bool decreasing, typename T>
+		__attribute__((target("sse4.2")))
+		size_t first_run_end_sse42(const T *a, size_t n) {
+			constexpr size_t lanes = 16 / sizeof(T);
+			size_t i = 0;
+			for (; i + lanes < n; i += lanes) {
+				const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+				const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 1));
+				unsigned mask;
+				if constexpr (sizeof(T) == 4)
+					mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(x, y)));
+				else
+					mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(x, y)));
+				if constexpr (decreasing) mask ^= (1u << lanes) - 1;
+				if (mask) return i + __builtin_ctz(mask);
+			}
+			return i + first_run_end_scalar<decreasing>(a + i, n - i);
+		}
+
+		inline bool has_avx2() {
+			static const bool result = __builtin_cpu_supports("avx2");
+			return result;
+		}
+
+		inline bool has_sse42() {
+			static const bool result = __builtin_cpu_supports("sse4.2");
+			return result;
+		}
+
+#endif // MERGESORTS_X86_SIMD
+
+		/** as first_run_end_scalar, with the widest vector instructions the CPU supports */
+		template<bool decreasing, typename T>
+		size_t first_run_end(const T *a, size_t n) {
+#ifdef MERGESORTS_X86_SIMD
+			if (has_avx2()) return first_run_end_avx2<decreasing>(a, n);
+			if (has_sse42()) return first_run_end_sse42<decreasing>(a, n);
+#endif
+			return first_run_end_scalar<decreasing>(a, n);
+		}
+
+		/**
+		 * returns maximal i <= end s.t. [begin,i) is weakly increasing (strictly decreasing
+		 * if decreasing is true), as weaklyIncreasingPrefix resp. strictlyDecreasingPrefix.
+		 * The first few pairs are checked one by one, so that short runs do not pay for
+		 * the dispatch and the unaligned loads.
+		 */
+		template<bool decreasing, typename T>
+		T *monotone_prefix(T *begin, T *end) {
+			constexpr int scalarPairs = 8;
+			for (int i = 0; i < scalarPairs; ++i, ++begin)
+				if (begin + 1 >= end || ends_run<decreasing>(*begin, *(begin + 1))) return begin + 1;
+			return begin + first_run_end<decreasing>(begin, end - begin) + 1;
+		}
+
+	}
+
+}
+
+#endif //MERGESORTS_RUN_DETECTION_SIMD_H
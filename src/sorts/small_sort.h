@@ -0,0 +1,187 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_SMALL_SORT_H
+#define MERGESORTS_SMALL_SORT_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include "insertionsort.h"
+
+namespace algorithms {
+
+	/**
+	 * Different choices for sorting short runs / subproblems.
+	 */
+	enum small_sort_methods {
+		INSERTIONSORT,
+		BINARY_INSERTIONSORT,
+		SORTING_NETWORK,
+	};
+
+	std::string to_string(small_sort_methods smallSortMethod) {
+		switch (smallSortMethod) {
+			case INSERTIONSORT: return "INSERTIONSORT";
+			case BINARY_INSERTIONSORT: return "BINARY_INSERTIONSORT";
+			case SORTING_NETWORK: return "SORTING_NETWORK";
+		}
+		assert(false);
+		__builtin_unreachable();
+	}
+
+	/**
+	 * sorts x and y without branches (for arithmetic types);
+	 * for integers, compilers tend to emit branches for std::min / std::max, so we swap via a mask.
+	 */
+	template<typename T>
+	inline void compare_exchange(T &x, T &y) {
+		const T a = x, b = y;
+		if constexpr (std::is_integral<T>::value) {
+			typedef typename std::make_unsigned<T>::type U;
+			const U swap = (U) (a ^ b) & (U) -(U) (b < a);
+			x = (T) ((U) a ^ swap);
+			y = (T) ((U) b ^ swap);
+		} else {
+			x = std::min(a, b);
+			y = std::max(a, b);
+		}
+	}
+
+	/** a comparator network: pairs of positions, in order */
+	template<size_t nComparators>
+	struct comparator_network {
+		unsigned char lo[nComparators], hi[nComparators];
+	};
+
+	/** number of comparators of Batcher's odd-even merge sort network for N inputs (a power of two) */
+	constexpr size_t odd_even_merge_sort_size(size_t N) {
+		size_t count = 0;
+		for (size_t p = 1; p < N; p <<= 1)
+			for (size_t k = p; k >= 1; k >>= 1)
+				for (size_t j = k % p; j + k < N; j += 2 * k)
+					for (size_t i = 0; i < std::min(k, N - j - k); ++i)
+						if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) ++count;
+		return count;
+	}
+
+	/** Batcher's odd-even merge sort network for N inputs (a power of two), computed at compile time */
+	template<size_t N>
+	constexpr comparator_network<odd_even_merge_sort_size(N)> odd_even_merge_sort_comparators() {
+		comparator_network<odd_even_merge_sort_size(N)> network {};
+		size_t c = 0;
+		for (size_t p = 1; p < N; p <<= 1)
+			for (size_t k = p; k >= 1; k >>= 1)
+				for (size_t j = k % p; j + k < N; j += 2 * k)
+					for (size_t i = 0; i < std::min(k, N - j - k); ++i)
+						if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+							network.lo[c] = i + j;
+							network.hi[c] = i + j + k;
+							++c;
+						}
+		return network;
+	}
+
+	/**
+	 * sorts a[0..N) using Batcher's odd-even merge sort network; N must be a power of two.
+	 * The comparators are fixed at compile time, so the only data-dependent operations
+	 * are the branchless compare_exchanges.
+	 */
+	template<size_t N, typename T>
+	void odd_even_merge_sort_network(T *a) {
+		static_assert((N & (N - 1)) == 0, "N must be a power of two");
+		static constexpr auto network = odd_even_merge_sort_comparators<N>();
+		constexpr size_t nComparators = odd_even_merge_sort_size(N);
+#pragma GCC unroll 256
+		for (size_t c = 0; c < nComparators; ++c)
+			compare_exchange(a[network.lo[c]], a[network.hi[c]]);
+	}
+
+	/** largest number of unsorted elements network_sort handles with a network */
+	constexpr size_t MAX_NETWORK_SIZE = 32;
+
+	/**
+	 * true if network_sort can be used for elements of type T; the order of equal elements cannot be observed for those.
+	 * Not for floating point: -0.0 and +0.0 compare equal but can be told apart, and NaNs break the padding.
+	 */
+	template<typename T>
+	constexpr bool network_sortable = std::is_integral<T>::value;
+
+	/**
+	 * sorts [begin,end), assuming that [begin,beginUnsorted) is already in order.
+	 * The (at most MAX_NETWORK_SIZE) unsorted elements are copied to a local array, padded to
+	 * the next power of two with the largest value and sorted by odd_even_merge_sort_network;
+	 * then they are merged with the sorted prefix from the right by a branchless merge.
+	 * If all of [begin,end) fits into the network, the prefix is sorted along instead.
+	 * Requires network_sortable elements.
+	 */
+	template<typename Iter>
+	void network_sort(Iter begin, Iter end, Iter beginUnsorted) {
+		typedef typename std::iterator_traits<Iter>::value_type T;
+		static_assert(network_sortable<T>, "sorting networks are not stable");
+		assert(begin <= beginUnsorted && beginUnsorted <= end);
+		// sorting a short prefix again is cheaper than merging with it
+		if (end - begin <= (ptrdiff_t) MAX_NETWORK_SIZE) beginUnsorted = begin;
+		const ptrdiff_t n2 = end - beginUnsorted;
+		assert(n2 <= (ptrdiff_t) MAX_NETWORK_SIZE);
+		if (n2 == 0) return;
+		const T sup = std::numeric_limits<T>::max();
+		T s[MAX_NETWORK_SIZE];
+		std::copy(beginUnsorted, end, s);
+		const ptrdiff_t padded = n2 <= 4 ? 4 : n2 <= 8 ? 8 : n2 <= 16 ? 16 : 32;
+		std::fill(s + n2, s + padded, sup);
+		switch (padded) {
+			case 4: odd_even_merge_sort_network<4>(s); break;
+			case 8: odd_even_merge_sort_network<8>(s); break;
+			case 16: odd_even_merge_sort_network<16>(s); break;
+			default: odd_even_merge_sort_network<32>(s); break;
+		}
+		// merge prefix and s from the right into [begin,end)
+		ptrdiff_t i = beginUnsorted - begin - 1, j = n2 - 1;
+		Iter out = end - 1;
+		while (i >= 0 && j >= 0) {
+			const bool takePrefix = s[j] < *(begin + i);
+			*out-- = takePrefix ? *(begin + i) : s[j];
+			i -= takePrefix;
+			j -= !takePrefix;
+		}
+		while (j >= 0) *out-- = s[j--];
+	}
+
+	/**
+	 * sorts [begin,end), assuming that [begin,beginUnsorted) is already in order,
+	 * using smallSortMethod.
+	 * SORTING_NETWORK falls back to insertionsort for types that are not network_sortable
+	 * (where it would not be stable) and for more than MAX_NETWORK_SIZE unsorted elements.
+	 */
+	template<small_sort_methods smallSortMethod, typename Iter>
+	void small_sort(Iter begin, Iter end, Iter beginUnsorted) {
+		typedef typename std::iterator_traits<Iter>::value_type T;
+		switch (smallSortMethod) {
+			case INSERTIONSORT:
+				return insertionsort(begin, end, beginUnsorted);
+			case BINARY_INSERTIONSORT:
+				return binary_insertionsort(begin, end, beginUnsorted);
+			case SORTING_NETWORK:
+				if constexpr (network_sortable<T>)
+					if (end - beginUnsorted <= (ptrdiff_t) MAX_NETWORK_SIZE)
+						return network_sort(begin, end, beginUnsorted);
+				return insertionsort(begin, end, beginUnsorted);
+		}
+	}
+
+	/**
+	 * sorts [begin,end) using smallSortMethod, assuming that the first
+	 * nPresorted elements are already in sorted order.
+	 **/
+	template<small_sort_methods smallSortMethod, typename Iter>
+	inline void small_sort(Iter begin, Iter end, size_t nPresorted = 1) {
+		small_sort<smallSortMethod>(begin, end, begin + std::min<size_t>(nPresorted, end - begin));
+	}
+
+}
+
+#endif //MERGESORTS_SMALL_SORT_H
@@ -0,0 +1,166 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_STREAMING_POWERSORT_H
+#define MERGESORTS_STREAMING_POWERSORT_H
+
+#include <cassert>
+#include <string>
+#include <vector>
+#include "../algorithms.h"
+#include "insertionsort.h"
+#include "merging.h"
+#include "powersort.h"
+
+namespace algorithms {
+
+	/**
+	 * Online Powersort: elements arrive in batches via append, and finish returns
+	 * all of them in sorted order.
+	 *
+	 * Runs are detected (and extended to minRunLen) as soon as they are complete,
+	 * i.e., once an element breaking them has arrived, and the merges of
+	 * powersort::power_sort_paper are done eagerly while appending;
+	 * finish only detects the last run and collapses the remaining stack of O(log n) runs.
+	 *
+	 * As n is not known upfront, node powers are computed w.r.t. nBound,
+	 * the smallest power of two >= max(expectedSize, elements so far).
+	 * Doubling nBound increases every node power by exactly one, so we store powers
+	 * relative to the number of doublings and never need to recompute them.
+	 * The merges are hence those of Powersort on the input padded to length nBound.
+	 *
+	 * @author Sebastian Wild (wild@liverpool.ac.uk)
+	 */
+	template<typename T,
+			unsigned int minRunLen = 24,
+			merging_methods mergingMethod = merging_methods::COPY_BOTH
+	>
+	class streaming_powersort {
+	private:
+		std::vector<T> _data;
+		scratch_space<T> _scratch;
+		const size_t _expectedSize;
+		size_t _nBound;
+		int _doublings = 0;
+
+		struct run_begin_n_power {
+			size_t begin;
+			int power; // node power w.r.t. nBound, minus _doublings at the time
+		};
+		std::vector<run_begin_n_power> _stack;
+		size_t _runABegin = 0, _runAEnd = 0; // last complete run, not yet on stack; empty if none
+		// [_scanBegin.._scanEnd) is known to be weakly increasing or (if _scanDescending) strictly decreasing,
+		// so that the scan of a run that is still growing resumes where it stopped
+		size_t _scanBegin = 0, _scanEnd = 0;
+		bool _scanDescending = false;
+
+		void merge(size_t l, size_t m, size_t r) {
+			const size_t bufferSize = merge_runs_buffer_size<mergingMethod>(m - l, r - m);
+			T *buffer = _scratch.get(bufferSize <= _scratch.capacity() ? bufferSize
+			                                                           : std::max(bufferSize, 2 * _scratch.capacity()));
+			merge_runs<mergingMethod>(_data.begin() + l, _data.begin() + m, _data.begin() + r, buffer);
+		}
+
+		/**
+		 * returns the end of the run starting at begin, after reversing / extending it,
+		 * or begin if it might still grow with further elements (unless final).
+		 * A run that is scanned again after more elements were appended is only scanned
+		 * from where the last scan stopped, so the total cost of scanning is linear.
+		 */
+		size_t next_run_end(size_t begin, bool final) {
+			auto b = _data.begin() + begin, n = _data.end();
+			const bool resume = begin == _scanBegin && _scanEnd >= begin + 2; // direction known
+			const bool descending = resume ? _scanDescending : b + 1 < n && *b > *(b + 1);
+			auto from = resume ? _data.begin() + (_scanEnd - 1) : b;
+			auto e = descending ? strictlyDecreasingPrefix(from, n) : weaklyIncreasingPrefix(from, n);
+			_scanBegin = begin, _scanEnd = e - _data.begin(), _scanDescending = descending;
+			size_t len = e - b;
+			if (len < minRunLen) {
+				if (!final && (size_t) (n - b) < minRunLen) return begin;
+				if (descending) std::reverse(b, e);
+				e = b + std::min<size_t>(minRunLen, n - b);
+				insertionsort(b, e, len);
+			} else {
+				if (!final && e == n) return begin;
+				if (descending) std::reverse(b, e);
+			}
+			return e - _data.begin();
+		}
+
+		/** detects complete runs and does the merges that powersort would do on them */
+		void process(bool final) {
+			while (_runAEnd < _data.size()) {
+				const size_t runBBegin = _runAEnd, runBEnd = next_run_end(runBBegin, final);
+				if (runBEnd == runBBegin) return;
+				if (_runABegin == _runAEnd) { // first run
+					_runAEnd = runBEnd;
+					continue;
+				}
+				const int power = (int) node_power_clz(0, _nBound, _runABegin, runBBegin, runBEnd) - _doublings;
+				// Invariant: powers on stack must be increasing from bottom to top
+				while (!_stack.empty() && _stack.back().power > power) {
+					merge(_stack.back().begin, _runABegin, _runAEnd);
+					_runABegin = _stack.back().begin;
+					_stack.pop_back();
+				}
+				_stack.push_back({_runABegin, power});
+				_runABegin = runBBegin;
+				_runAEnd = runBEnd;
+			}
+		}
+
+	public:
+
+		/** expectedSize is a hint for the total number of elements; it need not be exact */
+		explicit streaming_powersort(size_t expectedSize = 1 << 20)
+				: _expectedSize(std::max<size_t>(expectedSize, 1)), _nBound(1) {
+			while (_nBound < _expectedSize) _nBound *= 2;
+		}
+
+		/** adds the elements [begin, end) and does all merges that are already determined */
+		template<typename Iter>
+		void append(Iter begin, Iter end) {
+			_data.insert(_data.end(), begin, end);
+			while (_nBound < _data.size()) {
+				_nBound *= 2;
+				++_doublings;
+			}
+			process(false);
+		}
+
+		/** number of elements appended so far */
+		size_t size() const { return _data.size(); }
+
+		/** number of complete runs not merged yet */
+		size_t pending_runs() const { return _stack.size() + (_runABegin < _runAEnd); }
+
+		/**
+		 * sorts the remaining runs and returns all appended elements in sorted order;
+		 * afterwards, this object is empty and can be reused.
+		 */
+		std::vector<T> finish() {
+			process(true);
+			while (!_stack.empty()) {
+				merge(_stack.back().begin, _runABegin, _runAEnd);
+				_runABegin = _stack.back().begin;
+				_stack.pop_back();
+			}
+			assert(_runABegin == 0 && _runAEnd == _data.size());
+			std::vector<T> result;
+			result.swap(_data);
+			_runABegin = _runAEnd = 0;
+			_scanBegin = _scanEnd = 0;
+			_nBound = 1;
+			while (_nBound < _expectedSize) _nBound *= 2;
+			_doublings = 0;
+			return result;
+		}
+
+		std::string name() const {
+			return "StreamingPowerSort+minRunLen=" + std::to_string(minRunLen) +
+			       "+mergingMethod=" + to_string(mergingMethod);
+		}
+	};
+
+}
+
+#endif //MERGESORTS_STREAMING_POWERSORT_H
@@ -6,12 +6,13 @@
 #include "../algorithms.h"
 #include "merging.h"
 #include "insertionsort.h"
+#include "small_sort.h"
 
 /**
  * Simple top-down mergesort implementation.
  *
  * Recursion is stopped at subproblems of sizes at most insertionsortThreshold;
- * those are sorted by straight insertion sort.
+ * those are sorted by straight insertion sort (or another smallSortMethod, see small_sort.h).
  * If doSortedCheck is true, we check if two runs are by chance already
  * in sorted order before two runs are merged (compare last of left run with
  * first of right run).
@@ -21,18 +22,26 @@
 namespace algorithms {
 
 	template<typename Iterator, unsigned int insertionsortThreshold = 24, bool doSortedCheck = true,
-	        merging_methods mergingMethod = COPY_BOTH>
+	        merging_methods mergingMethod = COPY_BOTH, small_sort_methods smallSortMethod = INSERTIONSORT>
 	class top_down_mergesort final : public sorter<Iterator>
 	{
 	private:
 		using typename sorter<Iterator>::elem_t;
 		using typename sorter<Iterator>::diff_t;
-		std::vector<elem_t> _buffer;
+		scratch_space<elem_t> _ownScratch; // used unless scratch is passed to sort
+		elem_t *_buffer = nullptr;
+		size_t _bufferSize = 0;
 	public:
 
 		void sort(Iterator begin, Iterator end) override
 		{
-			_buffer.resize(end - begin);
+			sort(begin, end, _ownScratch);
+		}
+
+		void sort(Iterator begin, Iterator end, scratch_space<elem_t> &scratch) override
+		{
+			_bufferSize = end - begin;
+			_buffer = scratch.get(_bufferSize);
 			mergesort(begin, end);
 		}
 
@@ -41,18 +50,21 @@ namespace algorithms {
 		{
 			diff_t n = end - begin;
 			if (n <= insertionsortThreshold)
-				return insertionsort(begin, end);
+				return small_sort<smallSortMethod>(begin, end);
 			Iterator m = begin + (n >> 1);
 			mergesort(begin, m);
 			mergesort(m, end);
 			if (!doSortedCheck || *(m-1) > *m)
-				merge_runs<mergingMethod>(begin, m, end, _buffer.begin());
+				merge_runs<mergingMethod>(begin, m, end, _buffer);
 		}
 
+        long long scratch_elements() const override { return _bufferSize; }
+
         std::string name() const override {
             return "TopDownMergesort+iscutoff=" + std::to_string(insertionsortThreshold) +
                    "+checkSorted=" + std::to_string(doSortedCheck) +
-                   "+mergingMethod=" + to_string(mergingMethod);
+                   "+mergingMethod=" + to_string(mergingMethod) +
+                   (smallSortMethod != INSERTIONSORT ? "+smallSort=" + to_string(smallSortMethod) : "");
         }
 	};
 
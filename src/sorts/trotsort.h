@@ -24,7 +24,8 @@ namespace algorithms {
 
 		static const int MIN_MERGE = 32;
 
-		std::vector<value_t> buffer_; // temp storage for merges
+		value_t *buffer_; // temp storage for merges, taken from scratch space
+		int minGallop_ = MIN_GALLOP; // galloping threshold, kept across the merges of a sort
 
 		struct run {
 			iter_t base;
@@ -37,6 +38,11 @@ namespace algorithms {
 
 	public:
 		static void sort(iter_t const begin, iter_t const end) {
+			scratch_space<value_t> scratch;
+			sort(begin, end, scratch);
+		}
+
+		static void sort(iter_t const begin, iter_t const end, scratch_space<value_t> &scratch) {
 			assert(begin <= end);
 
 			size_t nRemaining = (end - begin);
@@ -50,7 +56,7 @@ namespace algorithms {
 				return;
 			}
 
-			TrotSort ts(nRemaining);
+			TrotSort ts(nRemaining, scratch);
 			auto const minRun = static_cast<const size_t>(minRunLength(nRemaining));
 			iter_t cur = begin;
 			do {
@@ -108,7 +114,7 @@ namespace algorithms {
 			return n + r;
 		}
 
-		TrotSort(size_t len) {
+		TrotSort(size_t len, scratch_space<value_t> &scratch) : buffer_(scratch.get(len)) {
 			/*
 			 * Allocate runs-to-be-merged stack (which cannot be expanded).  The
 			 * stack length requirements are described in listsort.txt.  The C
@@ -127,7 +133,6 @@ namespace algorithms {
 			                   len <   1542  ? 10 :
 			                   len < 119151  ? 24 : 49);
 			pending_.reserve(stackLen);
-			buffer_.resize(len);
 		}
 
 		void pushRun(iter_t const runBase, diff_t const runLen) {
@@ -186,7 +191,7 @@ namespace algorithms {
 			pending_.pop_back();
 
 			// Merge remaining runs, using tmp array with min(len1, len2) elements
-			merge_runs<mergingMethod>(base1, base2, base2 + len2, buffer_.begin());
+			merge_runs<mergingMethod>(base1, base2, base2 + len2, buffer_, minGallop_);
 
 		}
 
@@ -204,10 +209,14 @@ namespace algorithms {
 	class trotsort final : public sorter<Iterator> {
 	public:
 		void sort(Iterator begin, Iterator end) override {
-			typedef typename std::iterator_traits<Iterator>::value_type value_type;
 			TrotSort<Iterator,useBinaryInsertionsort, mergingMethod>::sort(begin, end);
 		}
 
+		void sort(Iterator begin, Iterator end,
+		          scratch_space<typename sorter<Iterator>::elem_t> &scratch) override {
+			TrotSort<Iterator,useBinaryInsertionsort, mergingMethod>::sort(begin, end, scratch);
+		}
+
 		std::string name() const override {
 			return std::string("TimsortTrot") +
 					std::string("-useBinaryInsertionsort=") + std::to_string(useBinaryInsertionsort);
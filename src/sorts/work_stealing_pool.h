@@ -0,0 +1,232 @@
+/** @author Sebastian Wild (wild@liverpool.ac.uk) */
+
+#ifndef MERGESORTS_WORK_STEALING_POOL_H
+#define MERGESORTS_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace algorithms {
+
+    /**
+     * Binds a thread_local variable, accessed through get and set, to value for the lifetime
+     * of the binding, and restores its previous value after.
+     * Tasks that the binding thread spawns into a work_stealing_pool meanwhile see the same
+     * value in whichever thread runs them (as do the tasks these spawn, and so on);
+     * they must have finished before the binding ends, as is the case for fork-join parallelism.
+     */
+    class thread_binding {
+    public:
+        typedef const void *(*getter)();
+        typedef void (*setter)(const void *);
+
+        thread_binding(getter get, setter set, const void *value) :
+                _get(get), _set(set), _value(value), _outerValue(get()), _next(_current) {
+            set(value);
+            _current = this;
+        }
+
+        ~thread_binding() {
+            _set(_outerValue);
+            _current = _next;
+        }
+
+        thread_binding(const thread_binding &) = delete;
+        thread_binding &operator=(const thread_binding &) = delete;
+
+    private:
+        friend class work_stealing_pool;
+        const getter _get;
+        const setter _set;
+        const void *const _value, *const _outerValue;
+        const thread_binding *const _next; // enclosing binding of the same thread
+
+        /** innermost binding of the current thread */
+        inline static thread_local const thread_binding *_current = nullptr;
+
+        /** sets the variable of b to b's value in the current thread until destroyed */
+        struct rebind {
+            const thread_binding *const b;
+            const void *const outerValue;
+            explicit rebind(const thread_binding *b) : b(b), outerValue(b->_get()) { b->_set(b->_value); }
+            ~rebind() { b->_set(outerValue); }
+        };
+
+        /**
+         * runs work in the current thread with the bindings in chain (from b outwards) in effect;
+         * bindings shadowed by inner ones of the same variable are skipped
+         */
+        template<typename F>
+        static void run_from(const thread_binding *chain, const thread_binding *b, F &work) {
+            if (b == nullptr) return work();
+            for (const thread_binding *inner = chain; inner != b; inner = inner->_next)
+                if (inner->_set == b->_set) return run_from(chain, b->_next, work);
+            const rebind bound(b);
+            run_from(chain, b->_next, work);
+        }
+
+        /** runs work in the current thread with the bindings of chain */
+        template<typename F>
+        static void run_with(const thread_binding *chain, F &work) {
+            struct restore_current {
+                const thread_binding *const outer = _current;
+                ~restore_current() { _current = outer; }
+            } restore;
+            _current = chain;
+            run_from(chain, chain, work);
+        }
+    };
+
+    /**
+     * A small fork-join thread pool with one task deque per thread.
+     *
+     * Threads push spawned tasks to the back of their own deque and take work
+     * from there (LIFO, good locality for recursive splits); idle threads steal
+     * from the front of other deques, i.e., they take the oldest and hence
+     * typically largest pending task.
+     * The thread calling wait() does not block but keeps executing pending tasks,
+     * so that nested fork-join parallelism cannot deadlock.
+     *
+     * The pool uses nThreads - 1 worker threads; the calling thread is the nThreads-th.
+     * Tasks run with the thread_bindings of the thread that spawned them.
+     *
+     * @author Sebastian Wild (wild@liverpool.ac.uk)
+     */
+    class work_stealing_pool {
+    public:
+        /** counts the unfinished tasks spawned into it */
+        class task_group {
+            friend class work_stealing_pool;
+            std::atomic<long> _pending {0};
+        };
+
+        explicit work_stealing_pool(unsigned nThreads) : _queues(std::max(nThreads, 1u)) {
+            for (unsigned i = 1; i < _queues.size(); ++i)
+                _workers.emplace_back([this, i] { worker_loop(i); });
+        }
+
+        work_stealing_pool(const work_stealing_pool &) = delete;
+        work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+
+        ~work_stealing_pool() {
+            {
+                std::lock_guard<std::mutex> lock(_idleMutex);
+                _stop = true;
+            }
+            _idle.notify_all();
+            for (auto &worker : _workers) worker.join();
+        }
+
+        unsigned n_threads() const { return _queues.size(); }
+
+        /** schedules task for execution by any thread of the pool, with the current thread_bindings */
+        void spawn(task_group &group, std::function<void()> task) {
+            group._pending.fetch_add(1, std::memory_order_relaxed);
+            queue &q = _queues[own_queue()];
+            {
+                std::lock_guard<std::mutex> lock(q.mutex);
+                q.tasks.push_back({std::move(task), &group, thread_binding::_current});
+            }
+            {
+                std::lock_guard<std::mutex> lock(_idleMutex);
+                ++_nQueued;
+            }
+            _idle.notify_one();
+        }
+
+        /** returns once all tasks spawned into group have finished; executes pending tasks meanwhile */
+        void wait(task_group &group) {
+            while (group._pending.load(std::memory_order_acquire) > 0)
+                if (!try_run_one(own_queue()))
+                    std::this_thread::yield();
+        }
+
+        /** runs f(0), ..., f(nTasks-1) in parallel; f(0) is run by the calling thread */
+        template<typename F>
+        void parallel_for(size_t nTasks, F f) {
+            if (nTasks == 1 || n_threads() == 1) {
+                for (size_t i = 0; i < nTasks; ++i) f(i);
+                return;
+            }
+            task_group tasks;
+            for (size_t i = 1; i < nTasks; ++i)
+                spawn(tasks, [&f, i] { f(i); });
+            f(0);
+            wait(tasks);
+        }
+
+    private:
+        struct task {
+            std::function<void()> work;
+            task_group *group;
+            const thread_binding *bindings; // of the spawning thread
+        };
+        struct queue {
+            std::mutex mutex;
+            std::deque<task> tasks;
+        };
+
+        std::vector<queue> _queues; // _queues[0] is used by threads from outside the pool
+        std::vector<std::thread> _workers;
+        std::mutex _idleMutex;
+        std::condition_variable _idle;
+        long _nQueued = 0; // guarded by _idleMutex
+        bool _stop = false; // guarded by _idleMutex
+
+        /** pool and queue index of the current thread if it is a worker */
+        inline static thread_local const work_stealing_pool *_currentPool = nullptr;
+        inline static thread_local unsigned _currentIndex = 0;
+
+        unsigned own_queue() const { return _currentPool == this ? _currentIndex : 0; }
+
+        bool try_pop(unsigned i, task &t, bool fromBack) {
+            queue &q = _queues[i];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) return false;
+            if (fromBack) {
+                t = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                t = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            return true;
+        }
+
+        bool try_run_one(unsigned self) {
+            task t;
+            bool found = try_pop(self, t, true);
+            for (unsigned k = 1; !found && k < _queues.size(); ++k)
+                found = try_pop((self + k) % _queues.size(), t, false); // steal oldest
+            if (!found) return false;
+            {
+                std::lock_guard<std::mutex> lock(_idleMutex);
+                --_nQueued;
+            }
+            thread_binding::run_with(t.bindings, t.work);
+            t.group->_pending.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+
+        void worker_loop(unsigned i) {
+            _currentPool = this;
+            _currentIndex = i;
+            while (true) {
+                if (try_run_one(i)) continue;
+                std::unique_lock<std::mutex> lock(_idleMutex);
+                _idle.wait(lock, [this] { return _stop || _nQueued > 0; });
+                if (_stop) return;
+            }
+        }
+    };
+
+}
+
+#endif //MERGESORTS_WORK_STEALING_POOL_H
@@ -11,6 +11,7 @@
 #include <iostream>
 #include <include/gtest/gtest.h>
 #include "../algorithms.h"
+#include "../datatypes.h"
 #include "checked_vector.h"
 #include "merging_multiway.h"
 #include "merging_3way.h"
@@ -31,7 +32,7 @@ struct not_sorted : public std::exception {
 };
 
 
-template <algorithms::merging4way_methods mergingMethod, int bufferOversize = 4>
+template <algorithms::merging4way_methods mergingMethod, int bufferOversize = 4, bool trim = false>
 bool harness_4way_merge(bool harness_3way_method_instead = false)
 {
     auto k = harness_3way_method_instead ? 3 : 4;
@@ -45,13 +46,13 @@ bool harness_4way_merge(bool harness_3way_method_instead = false)
             checked_vector<int> B (std::vector<int> (n+bufferOversize));
 			try {
                 if (harness_3way_method_instead)
-                    algorithms::merge_3runs<mergingMethod>(copy.begin(),
+                    algorithms::merge_3runs<mergingMethod, trim>(copy.begin(),
                                                            copy.begin() + (it[1]-it[0]),
                                                            copy.begin() + (it[2]-it[0]),
                                                            copy.begin() + (it[3]-it[0]),
                                                            B.begin());
                 else
-                    algorithms::merge_4runs<mergingMethod>(copy.begin(),
+                    algorithms::merge_4runs<mergingMethod, trim>(copy.begin(),
                                                            copy.begin() + (it[1]-it[0]),
                                                            copy.begin() + (it[2]-it[0]),
                                                            copy.begin() + (it[3]-it[0]),
@@ -83,13 +84,13 @@ bool harness_4way_merge(bool harness_3way_method_instead = false)
             checked_vector<int> B (std::vector<int> (n+bufferOversize));
 			try {
                 if (harness_3way_method_instead)
-                    algorithms::merge_3runs<mergingMethod>(copy.begin(),
+                    algorithms::merge_3runs<mergingMethod, trim>(copy.begin(),
                                                            copy.begin() + (it[1]-it[0]),
                                                            copy.begin() + (it[2]-it[0]),
                                                            copy.begin() + (it[3]-it[0]),
                                                            B.begin());
                 else
-                    algorithms::merge_4runs<mergingMethod>(copy.begin(),
+                    algorithms::merge_4runs<mergingMethod, trim>(copy.begin(),
                                                            copy.begin() + (it[1]-it[0]),
                                                            copy.begin() + (it[2]-it[0]),
                                                            copy.begin() + (it[3]-it[0]),
@@ -120,13 +121,13 @@ bool harness_4way_merge(bool harness_3way_method_instead = false)
         checked_vector<int> B (std::vector<int> (n+bufferOversize));
         try {
             if (harness_3way_method_instead)
-                algorithms::merge_3runs<mergingMethod>(copy.begin(),
+                algorithms::merge_3runs<mergingMethod, trim>(copy.begin(),
                                                        copy.begin() + (it[1]-it[0]),
                                                        copy.begin() + (it[2]-it[0]),
                                                        copy.begin() + (it[3]-it[0]),
                                                        B.begin());
             else
-                algorithms::merge_4runs<mergingMethod>(copy.begin(),
+                algorithms::merge_4runs<mergingMethod, trim>(copy.begin(),
                                                        copy.begin() + (it[1]-it[0]),
                                                        copy.begin() + (it[2]-it[0]),
                                                        copy.begin() + (it[3]-it[0]),
@@ -260,6 +261,53 @@ bool harness_sorter(Sorter & sorter)
 	return true;
 }
 
+/** records with equal keys (first entry), distinguishable by their original position (second entry) */
+typedef data::blob<2, int, data::FIRST_ENTRY> stable_item;
+
+/** returns n records (blobs compared by their first entry) with random keys in [0,nKeys) and positions 0..n-1 */
+template<typename Item = stable_item>
+std::vector<Item> new_stable_items(int n, int nKeys, inputs::RNG &rng)
+{
+	std::vector<Item> a(n);
+	for (int i = 0; i < n; ++i) {
+		a[i].a[0] = inputs::next_int(nKeys, rng);
+		a[i].a[1] = i;
+	}
+	return a;
+}
+
+/**
+ * checks that [result, result + (end-begin)) is [begin,end) stably sorted (as by std::stable_sort),
+ * comparing keys and second entries of the records (see stable_item)
+ */
+template<typename Iter, typename Iter2>
+bool is_stable_sort_of(Iter begin, Iter end, Iter2 result)
+{
+	std::vector<typename std::iterator_traits<Iter>::value_type> expected(begin, end);
+	std::stable_sort(expected.begin(), expected.end());
+	for (size_t i = 0; i < expected.size(); ++i, ++result) {
+		if (expected[i].a[0] != (*result).a[0] || expected[i].a[1] != (*result).a[1]) {
+			std::cerr << "ERROR: not stably sorted at position " << i << ": expected (" << expected[i].a[0] << ", "
+			          << expected[i].a[1] << "), found (" << (*result).a[0] << ", " << (*result).a[1] << ")" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+/** sorts a copy of input with sorter (on pointers) and checks that the result is stable */
+template<typename Sorter, typename Item>
+bool harness_stable_sorter(Sorter & sorter, const std::vector<Item> & input)
+{
+	std::vector<Item> copy = input;
+	sorter.sort(copy.data(), copy.data() + copy.size());
+	if (!is_stable_sort_of(input.begin(), input.end(), copy.begin())) {
+		std::cerr << "while sorting with " << sorter.name() << std::endl;
+		return false;
+	}
+	return true;
+}
+
 
 
 #endif //MERGESORTS_SORTER_HARNESS_H
@@ -2,7 +2,11 @@
 // Created by seb on 5/20/18.
 //
 
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
+#include <new>
+#include <thread>
 #include "gtest/gtest.h"
 #include "sorter_harness.h"
 #include "checked_vector.h"
@@ -18,6 +22,14 @@
 #include "sorts/top_down_mergesort.h"
 #include "sorts/bottom_up_mergesort.h"
 #include "sorts/powersort_4way.h"
+#include "sorts/powersort_kway.h"
+#include "sorts/powersort_parallel.h"
+#include "sorts/external_powersort.h"
+#include "sorts/streaming_powersort.h"
+#include "sorts/keyed_powersort.h"
+#include "sorts/indirect_sort.h"
+#include "sorts/pingpong_powersort.h"
+#include "datatypes.h"
 
 std::random_device rd;
 inputs::RNG rng(rd());
@@ -35,6 +47,17 @@ void print(Iter start, Iter end) {
 	std::cout << "]" << std::endl;
 }
 
+// count heap allocations (of all threads), e.g. to check that merges do not allocate
+std::atomic<long long> heapAllocations {0};
+
+void *operator new(size_t size) {
+	++heapAllocations;
+	if (void *p = std::malloc(size > 0 ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
 
 struct MergingTest : public ::testing::Test {
 	//                                              0  1   2   3   4   5  6  7  8  9    10
@@ -119,6 +142,97 @@ TEST_F(MergingTest, mergeBasicSentinelExample) {
 }
 
 
+TEST_F(MergingTest, mergeBasicCountedExample) {
+	auto a = v.begin();
+    auto a2 = v2.begin();
+	auto b = buffer.begin();
+	algorithms::merge_runs_basic_counted(a, a + 5, a + 11, b);
+	ASSERT_EQ(v, v_sorted);
+    algorithms::merge_runs_basic_counted(a2, a2 + 6, a2 + 11, b);
+    ASSERT_EQ(v2, v_sorted);
+}
+
+TEST_F(MergingTest, mergeBidirectionalExample) {
+	auto a = v.begin();
+    auto a2 = v2.begin();
+	auto b = buffer.begin();
+	algorithms::merge_runs_bidirectional(a, a + 5, a + 11, b);
+	ASSERT_EQ(v, v_sorted);
+    algorithms::merge_runs_bidirectional(a2, a2 + 6, a2 + 11, b);
+    ASSERT_EQ(v2, v_sorted);
+}
+
+TEST_F(MergingTest, gallopingExample) {
+	auto a = v.begin();
+    auto a2 = v2.begin();
+	auto b = buffer.begin();
+	algorithms::merge_runs_galloping(a, a + 5, a + 11, b);
+	ASSERT_TRUE(std::is_sorted(v.begin(),v.end()));
+	ASSERT_EQ(v, v_sorted);
+    algorithms::merge_runs_galloping(a2, a2 + 6, a2 + 11, b);
+    ASSERT_TRUE(std::is_sorted(v2.begin(),v2.end()));
+    ASSERT_EQ(v2, v_sorted);
+}
+
+TEST_F(MergingTest, symmergeExample) {
+	auto a = v.begin();
+    auto a2 = v2.begin();
+	algorithms::merge_runs_symmerge(a, a + 5, a + 11);
+	ASSERT_TRUE(std::is_sorted(v.begin(),v.end()));
+	ASSERT_EQ(v, v_sorted);
+    algorithms::merge_runs_symmerge(a2, a2 + 6, a2 + 11);
+    ASSERT_TRUE(std::is_sorted(v2.begin(),v2.end()));
+    ASSERT_EQ(v2, v_sorted);
+}
+
+TEST(merging, symmergeStable) {
+	for (int iter = 0; iter < 500; ++iter) {
+		int n1 = inputs::next_int(50, rng), n2 = inputs::next_int(50, rng);
+		auto a = new_stable_items(n1 + n2, 10, rng);
+		std::stable_sort(a.begin(), a.begin() + n1);
+		std::stable_sort(a.begin() + n1, a.end());
+		const auto input = a;
+		algorithms::merge_runs_symmerge(a.begin(), a.begin() + n1, a.end());
+		ASSERT_TRUE(is_stable_sort_of(input.begin(), input.end(), a.begin()));
+	}
+}
+
+TEST(merging, gallopingStableOnClusteredRuns) {
+	// runs interleave in blocks of varying length with many equal keys
+	for (int n1 : {1, 7, 300, 2000}) for (int n2 : {1, 7, 300, 2000}) {
+		std::vector<stable_item> a(n1 + n2);
+		int key = 0;
+		for (int i = 0; i < n1 + n2; ++i) {
+			if (inputs::next_int(20, rng) == 0) key += inputs::next_int(3, rng);
+			a[i].a[0] = key;
+		}
+		std::shuffle(a.begin(), a.end(), rng);
+		std::stable_sort(a.begin(), a.begin() + n1);
+		std::stable_sort(a.begin() + n1, a.end());
+		for (int i = 0; i < n1 + n2; ++i) a[i].a[1] = i;
+		const auto input = a;
+		std::vector<stable_item> B(std::min(n1, n2));
+		algorithms::merge_runs_galloping(a.begin(), a.begin() + n1, a.end(), B.begin());
+		ASSERT_TRUE(is_stable_sort_of(input.begin(), input.end(), a.begin()));
+	}
+}
+
+TEST(merging, gallopingThresholdCarriesAcrossMerges) {
+	int minGallop = algorithms::MIN_GALLOP;
+	// runs interleaving in long blocks: galloping pays off, so the threshold drops
+	std::vector<int> a(2000), B(1000);
+	for (int i = 0; i < 2000; ++i) a[i] = i < 1000 ? (i / 100) * 200 + i % 100 : ((i - 1000) / 100) * 200 + 100 + i % 100;
+	algorithms::merge_runs_galloping(a.begin(), a.begin() + 1000, a.end(), B.begin(), minGallop);
+	ASSERT_TRUE(std::is_sorted(a.begin(), a.end()));
+	ASSERT_LT(minGallop, algorithms::MIN_GALLOP);
+	const int afterBlocks = minGallop;
+	// the next merge starts from there: short blocks of 4 now suffice to start galloping,
+	// which does not pay off, so the threshold rises again
+	for (int i = 0; i < 2000; ++i) a[i] = i < 1000 ? (i / 4) * 8 + i % 4 : ((i - 1000) / 4) * 8 + 4 + i % 4;
+	algorithms::merge_runs<algorithms::GALLOPING>(a.begin(), a.begin() + 1000, a.end(), B.begin(), minGallop);
+	ASSERT_TRUE(std::is_sorted(a.begin(), a.end()));
+	ASSERT_GT(minGallop, afterBlocks);
+}
 
 TEST_F(MergingTest, fourwayWillemEmptyLastRuns) {
 	auto a = v.begin();
@@ -213,6 +327,83 @@ TEST_F(MergingTest, weaklyIncreasingLeft) {
 	ASSERT_EQ(algorithms::weaklyIncreasingSuffix(v.begin(), v.end()), v.begin());
 }
 
+template<typename T>
+void checkVectorizedRunDetection() {
+	inputs::RNG rng(17);
+	std::vector<T> a(3000);
+	for (int runLen : {1, 3, 10, 100, 1000}) {
+		for (auto &x : a) x = (T) inputs::next_int(20, rng) - 10; // many equal neighbours
+		inputs::sort_random_runs(a.begin(), a.end(), runLen, rng);
+		for (size_t i = 0; i + 2 * runLen < a.size(); i += 2 * runLen) // alternate directions
+			std::reverse(a.begin() + i, a.begin() + i + runLen);
+		for (size_t b = 0; b < 300; ++b) {
+			for (size_t e : {b + 1, b + 2, b + 9, b + 17, b + 100, a.size()}) {
+				T *begin = &a[0] + b, *end = &a[0] + std::min(e, a.size());
+				T *inc = begin, *dec = begin;
+				while (inc + 1 < end && *inc <= *(inc + 1)) ++inc;
+				while (dec + 1 < end && *dec > *(dec + 1)) ++dec;
+				ASSERT_EQ(inc + 1, algorithms::weaklyIncreasingPrefix(begin, end));
+				ASSERT_EQ(dec + 1, algorithms::strictlyDecreasingPrefix(begin, end));
+#ifdef MERGESORTS_X86_SIMD
+				const size_t n = end - begin;
+				ASSERT_EQ(inc - begin, algorithms::simd::first_run_end_sse42<false>(begin, n));
+				ASSERT_EQ(dec - begin, algorithms::simd::first_run_end_sse42<true>(begin, n));
+				if (algorithms::simd::has_avx2()) {
+					ASSERT_EQ(inc - begin, algorithms::simd::first_run_end_avx2<false>(begin, n));
+					ASSERT_EQ(dec - begin, algorithms::simd::first_run_end_avx2<true>(begin, n));
+				}
+#endif
+			}
+		}
+	}
+}
+
+TEST(merging, vectorizedRunDetectionMatchesScalar) {
+	static_assert(algorithms::simd::vectorizable<int *>::value, "");
+	static_assert(!algorithms::simd::vectorizable<std::vector<int>::iterator>::value, "");
+	checkVectorizedRunDetection<int>();
+	checkVectorizedRunDetection<long>();
+}
+
+template<typename T>
+void checkVectorizedMerge() {
+	inputs::RNG rng(29);
+	for (int n1 : {0, 1, 3, 4, 7, 8, 9, 16, 31, 100, 1000})
+		for (int n2 : {0, 2, 4, 5, 8, 15, 17, 64, 999})
+			for (int u : {3, 1000000}) {
+				std::vector<T> a(n1 + n2), buffer(n1 + n2);
+				for (auto &x : a) x = (T) inputs::next_int(u, rng) - u / 2;
+				std::sort(a.begin(), a.begin() + n1);
+				std::sort(a.begin() + n1, a.end());
+				auto expected = a;
+				std::inplace_merge(expected.begin(), expected.begin() + n1, expected.end());
+				T *l = a.data();
+				algorithms::merge_runs<algorithms::VECTORIZED_BITONIC_MERGE>(l, l + n1, l + (n1 + n2), buffer.data());
+				ASSERT_EQ(expected, a);
+			}
+}
+
+TEST(merging, vectorizedBitonicMerge) {
+	static_assert(algorithms::default_merging_method<int *> == algorithms::VECTORIZED_BITONIC_MERGE, "");
+	static_assert(algorithms::default_merging_method<std::vector<int>::iterator> == algorithms::COPY_BOTH, "");
+	checkVectorizedMerge<int>();
+	checkVectorizedMerge<long>();
+	inputs::RNG rng(31);
+	for (int runLen : {3, 300}) {
+		std::vector<long> a(100000);
+		for (auto &x : a) x = inputs::next_int(50000, rng) - 1000000000000L;
+		inputs::sort_random_runs(a.begin(), a.end(), runLen, rng);
+		auto expected = a, b = a;
+		std::sort(expected.begin(), expected.end());
+		algorithms::powersort<long *> ps;
+		ps.sort(a.data(), a.data() + a.size());
+		ASSERT_EQ(expected, a);
+		algorithms::powersort_4way<long *, 24, algorithms::GENERAL_BY_STAGES_SPLIT> ps4;
+		ps4.sort(b.data(), b.data() + b.size());
+		ASSERT_EQ(expected, b);
+	}
+}
+
 
 
 
@@ -236,6 +427,46 @@ TEST(insertionsort, exampleBinary) {
 	ASSERT_TRUE(std::is_sorted(v.begin(),v.end()));
 }
 
+template<typename T>
+void checkSortingNetworks() {
+	inputs::RNG rng(3);
+	for (int n = 0; n <= 40; ++n)
+		for (int nPresorted = 0; nPresorted <= n; ++nPresorted)
+			for (int u : {2, 1000}) {
+				std::vector<T> a(n);
+				for (auto &x : a) x = (T) inputs::next_int(u, rng) - (T) (u / 2);
+				if (n > 0 && u == 1000) a[0] = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+				                                                                   : std::numeric_limits<T>::max();
+				std::sort(a.begin(), a.begin() + nPresorted);
+				auto expected = a;
+				std::sort(expected.begin(), expected.end());
+				auto b = a;
+				algorithms::small_sort<algorithms::SORTING_NETWORK>(a.begin(), a.end(), a.begin() + nPresorted);
+				ASSERT_EQ(expected, a);
+				algorithms::small_sort<algorithms::BINARY_INSERTIONSORT>(b.begin(), b.end(), b.begin() + nPresorted);
+				ASSERT_EQ(expected, b);
+			}
+}
+
+TEST(insertionsort, sortingNetworks) {
+	checkSortingNetworks<int>();
+	checkSortingNetworks<long>();
+	checkSortingNetworks<short>();
+	// floating point is not network_sortable: equal -0.0 and +0.0 keep their order
+	std::vector<double> zeros(20);
+	for (int i = 0; i < 20; ++i) zeros[i] = i % 3 == 0 ? -0.0 : i % 3 == 1 ? 0.0 : -1.0 * i;
+	auto stableZeros = zeros;
+	std::stable_sort(stableZeros.begin(), stableZeros.end());
+	algorithms::small_sort<algorithms::SORTING_NETWORK>(zeros.begin(), zeros.end());
+	for (int i = 0; i < 20; ++i) ASSERT_EQ(std::signbit(stableZeros[i]), std::signbit(zeros[i]));
+	// not network_sortable: falls back to (stable) insertionsort
+	std::vector<stable_item> a(30);
+	for (int i = 0; i < 30; ++i) a[i].a[0] = (7 * i) % 3, a[i].a[1] = i;
+	const auto input = a;
+	algorithms::small_sort<algorithms::SORTING_NETWORK>(a.begin(), a.end());
+	ASSERT_TRUE(is_stable_sort_of(input.begin(), input.end(), a.begin()));
+}
+
 
 
 
@@ -276,7 +507,7 @@ TEST(inputs, testNewRandomPerm) {
 
 TEST(inputs, testSortUpAndDown) {
 	std::vector<float> v (20) ;
-	std::vector<int> l {5,4,2,2,7} ;
+	std::vector<size_t> l {5,4,2,2,7} ;
 	inputs::fill_with_up_and_down_runs(v.begin(), v.end(), l, 1, rng);
 	auto a = v.begin();
 	ASSERT_TRUE(std::is_sorted(a,a+5));
@@ -370,6 +601,148 @@ TEST(harness, harness4wayWillemTuned) {
     ASSERT_TRUE((harness_4way_merge<algorithms::WILLEM_TUNED,3>(true)));
 }
 
+TEST(harness, harness4wayWillemCounted) {
+    ASSERT_TRUE((harness_4way_merge<algorithms::WILLEM_COUNTED,0>()));
+    ASSERT_TRUE((harness_4way_merge<algorithms::WILLEM_COUNTED,0>(true)));
+    ASSERT_TRUE((harness_4way_merge<algorithms::WILLEM_COUNTED,0,true>()));
+}
+
+TEST(harness, harness4wayTrimmed) {
+    ASSERT_TRUE((harness_4way_merge<algorithms::GENERAL_BY_STAGES_SPLIT,1,true>()));
+    ASSERT_TRUE((harness_4way_merge<algorithms::GENERAL_BY_STAGES_SPLIT,1,true>(true)));
+    ASSERT_TRUE((harness_4way_merge<algorithms::WILLEM_TUNED,4,true>()));
+    ASSERT_TRUE((harness_4way_merge<algorithms::WILLEM_TUNED,4,true>(true)));
+}
+
+TEST(merging, boundedBufferMerge) {
+    for (int iter = 0; iter < 300; ++iter) {
+        int n1 = inputs::next_int(60, rng), n2 = inputs::next_int(60, rng);
+        std::vector<int> a(n1 + n2);
+        for (int &x : a) x = inputs::next_int(30, rng);
+        std::sort(a.begin(), a.begin() + n1);
+        std::sort(a.begin() + n1, a.end());
+        auto expected = a;
+        std::sort(expected.begin(), expected.end());
+        for (size_t bufferSize : {0, 1, 5, 60}) {
+            auto b = a;
+            std::vector<int> B(bufferSize);
+            algorithms::merge_runs_bounded_buffer(b.begin(), b.begin() + n1, b.end(), B.begin(), bufferSize);
+            ASSERT_EQ(expected, b);
+        }
+    }
+}
+
+TEST(merging, stagesSplitMergesDoNotAllocate) {
+    inputs::RNG rng2(31);
+    for (int n : {10, 1000, 100000}) {
+        std::vector<int> a(n), b(n);
+        for (int &x : a) x = inputs::next_int(n, rng2);
+        const int g1 = n / 5, g2 = n / 2, g3 = n - n / 3;
+        std::sort(a.begin(), a.begin() + g1); std::sort(a.begin() + g1, a.begin() + g2);
+        std::sort(a.begin() + g2, a.begin() + g3); std::sort(a.begin() + g3, a.end());
+        auto expected = a;
+        std::sort(expected.begin(), expected.end());
+        algorithms::scratch_space<int> B(n + 4);
+        std::vector<stable_item> records(n);
+        for (int i = 0; i < n; ++i) records[i].a[0] = a[i], records[i].a[1] = i;
+        const auto recordsInput = records;
+        algorithms::scratch_space<stable_item> recordsB(n + 4);
+        b = a;
+        const long long before = heapAllocations.load();
+        algorithms::merge_4runs<algorithms::GENERAL_BY_STAGES_SPLIT>(a.begin(), a.begin() + g1, a.begin() + g2, a.begin() + g3, a.end(), B.get(n + 4));
+        algorithms::merge_3runs<algorithms::GENERAL_BY_STAGES_SPLIT>(b.begin(), b.begin() + g1, b.begin() + g2, b.begin() + g3, B.get(n + 4));
+        algorithms::merge_4runs<algorithms::GENERAL_BY_STAGES_SPLIT, true>(
+                records.begin(), records.begin() + g1, records.begin() + g2, records.begin() + g3, records.end(), recordsB.get(n + 4));
+        ASSERT_EQ(before, heapAllocations.load());
+        ASSERT_EQ(expected, a);
+        ASSERT_TRUE(std::is_sorted(b.begin(), b.begin() + g3));
+        ASSERT_TRUE(is_stable_sort_of(recordsInput.begin(), recordsInput.end(), records.begin()));
+    }
+}
+
+TEST(merging, trimmedMergesOnOverlappingRuns) {
+    // runs overlap only partially, with equal keys across run boundaries
+    for (int iter = 0; iter < 200; ++iter) {
+        int n[4], total = 0;
+        for (int &len : n) total += len = inputs::next_int(40, rng);
+        std::vector<int> a;
+        for (int i = 0; i < 4; ++i) {
+            std::vector<int> run(n[i]);
+            for (int &x : run) x = 10 * i + inputs::next_int(25, rng);
+            std::sort(run.begin(), run.end());
+            a.insert(a.end(), run.begin(), run.end());
+        }
+        auto expected = a;
+        std::sort(expected.begin(), expected.end());
+        std::vector<int> B(total + 4);
+        auto g1 = n[0], g2 = g1 + n[1], g3 = g2 + n[2];
+        auto b = a;
+        algorithms::merge_runs<algorithms::COPY_SMALLER, true>(b.begin(), b.begin() + g1, b.begin() + g2, B.begin());
+        algorithms::merge_runs<algorithms::COPY_BOTH_WITH_SENTINELS, true>(b.begin(), b.begin() + g2, b.begin() + g3, B.begin());
+        algorithms::merge_runs<algorithms::GALLOPING, true>(b.begin(), b.begin() + g3, b.end(), B.begin());
+        ASSERT_EQ(expected, b);
+        b = a;
+        algorithms::merge_3runs<algorithms::GENERAL_BY_STAGES_SPLIT, true>(b.begin(), b.begin() + g1, b.begin() + g2, b.begin() + g3, B.begin());
+        algorithms::merge_runs<algorithms::COPY_BOTH, true>(b.begin(), b.begin() + g3, b.end(), B.begin());
+        ASSERT_EQ(expected, b);
+        b = a;
+        algorithms::merge_4runs<algorithms::WILLEM_TUNED, true>(b.begin(), b.begin() + g1, b.begin() + g2, b.begin() + g3, b.end(), B.begin());
+        ASSERT_EQ(expected, b);
+        // vanishing runs fall back to merges with the given 2-way method
+        b = a;
+        algorithms::merge_4runs<algorithms::GENERAL_BY_STAGES_SPLIT, true, algorithms::VECTORIZED_BITONIC_MERGE>(
+                b.begin(), b.begin() + g1, b.begin() + g2, b.begin() + g3, b.end(), B.begin());
+        ASSERT_EQ(expected, b);
+        b = a;
+        algorithms::merge_3runs<algorithms::LOSER_TREE, true, algorithms::GALLOPING>(b.begin(), b.begin() + g1, b.begin() + g2, b.begin() + g3, B.begin());
+        algorithms::merge_4runs<algorithms::WILLEM_COUNTED, true, algorithms::COPY_BOTH_COUNTED>(
+                b.begin(), b.begin() + g3, b.begin() + g3, b.end(), b.end(), B.begin());
+        ASSERT_EQ(expected, b);
+        b = a;
+        algorithms::work_stealing_pool pool {2};
+        algorithms::parallel_merge_4runs<true>(b.begin(), b.begin() + g1, b.begin() + g2, b.begin() + g3, b.end(), B.begin(), pool);
+        ASSERT_EQ(expected, b);
+    }
+}
+
+TEST(merging, countedMergesStable) {
+    // many equal keys; blobs have no sentinels
+    inputs::RNG rng2(29);
+    for (int iter = 0; iter < 300; ++iter) {
+        int n = inputs::next_int(300, rng2);
+        auto a = new_stable_items(n, 20, rng2);
+        int g[] = {0, inputs::next_int(n + 1, rng2), inputs::next_int(n + 1, rng2), inputs::next_int(n + 1, rng2), n};
+        std::sort(g, g + 5);
+        for (int i = 0; i < 4; ++i) std::stable_sort(a.begin() + g[i], a.begin() + g[i + 1]);
+        std::vector<stable_item> B(n);
+        auto b = a;
+        algorithms::merge_runs<algorithms::COPY_BOTH_COUNTED>(b.begin(), b.begin() + g[1], b.begin() + g[2], B.begin());
+        ASSERT_TRUE(is_stable_sort_of(a.begin(), a.begin() + g[2], b.begin()));
+        b = a;
+        algorithms::merge_3runs<algorithms::WILLEM_COUNTED>(b.begin(), b.begin() + g[1], b.begin() + g[2], b.begin() + g[3], B.begin());
+        ASSERT_TRUE(is_stable_sort_of(a.begin(), a.begin() + g[3], b.begin()));
+        b = a;
+        algorithms::merge_4runs<algorithms::WILLEM_COUNTED>(b.begin(), b.begin() + g[1], b.begin() + g[2], b.begin() + g[3], b.end(), B.begin());
+        ASSERT_TRUE(is_stable_sort_of(a.begin(), a.end(), b.begin()));
+    }
+}
+
+TEST(merging, bidirectionalMergeStable) {
+    // balanced and very unbalanced runs
+    inputs::RNG rng2(31);
+    for (int iter = 0; iter < 500; ++iter) {
+        int n = inputs::next_int(300, rng2), m = inputs::next_int(n + 1, rng2);
+        if (iter % 3 == 0) m = std::min(n, inputs::next_int(4, rng2));
+        auto a = new_stable_items(n, 1 + iter % 40, rng2);
+        std::stable_sort(a.begin(), a.begin() + m);
+        std::stable_sort(a.begin() + m, a.end());
+        const auto input = a;
+        std::vector<stable_item> B(n);
+        algorithms::merge_runs<algorithms::COPY_BOTH_BIDIRECTIONAL>(a.begin(), a.begin() + m, a.end(), B.begin());
+        ASSERT_TRUE(is_stable_sort_of(input.begin(), input.end(), a.begin()));
+    }
+}
+
 TEST(harness, harnessTopDownMergesort) {
 	algorithms::top_down_mergesort<vec_iter , 1, false> tdmp;
 	ASSERT_TRUE(harness_sorter(tdmp));
@@ -377,6 +750,8 @@ TEST(harness, harnessTopDownMergesort) {
 	ASSERT_TRUE(harness_sorter(tdmp2));
 	algorithms::top_down_mergesort<vec_iter> tdmp3;
 	ASSERT_TRUE(harness_sorter(tdmp3));
+	algorithms::top_down_mergesort<vec_iter, 24, true, algorithms::COPY_BOTH, algorithms::SORTING_NETWORK> network;
+	ASSERT_TRUE(harness_sorter(network));
 }
 
 TEST(harness, harnessBottonUpMergesort) {
@@ -386,6 +761,8 @@ TEST(harness, harnessBottonUpMergesort) {
 	ASSERT_TRUE(harness_sorter(withMinRunLen));
 	algorithms::bottom_up_mergesort<vec_iter,1, true> withCheck;
 	ASSERT_TRUE(harness_sorter(withCheck));
+	algorithms::bottom_up_mergesort<vec_iter, 24, true, algorithms::COPY_BOTH, algorithms::SORTING_NETWORK> network;
+	ASSERT_TRUE(harness_sorter(network));
 }
 
 TEST(harness, harnessPeeksort) {
@@ -397,6 +774,12 @@ TEST(harness, harnessPeeksort) {
 	ASSERT_TRUE(harness_sorter(basic8));
 	algorithms::peeksort<vec_iter, 1, true> basicInc;
 	ASSERT_TRUE(harness_sorter(basicInc));
+	algorithms::peeksort<vec_iter, 24, false, algorithms::COPY_BOTH, algorithms::SORTING_NETWORK> network;
+	ASSERT_TRUE(harness_sorter(network));
+	algorithms::peeksort<vec_iter, 8, false, algorithms::GALLOPING> galloping;
+	ASSERT_TRUE(harness_sorter(galloping));
+	algorithms::peeksort<vec_iter, 8, false, algorithms::COPY_BOTH_BIDIRECTIONAL> bidirectional;
+	ASSERT_TRUE(harness_sorter(bidirectional));
 }
 
 
@@ -415,6 +798,28 @@ TEST(harness, harnessPowersort) {
 	ASSERT_TRUE(harness_sorter(msb));
 	algorithms::powersort<vec_iter, 1, algorithms::UNSTABLE_BITONIC_MERGE, true, algorithms::BITWISE_LOOP> inc {};
 	ASSERT_TRUE(harness_sorter(inc));
+	algorithms::powersort<vec_iter, 1, algorithms::GALLOPING> galloping {};
+	ASSERT_TRUE(harness_sorter(galloping));
+	algorithms::powersort<vec_iter, 1, algorithms::COPY_BOTH_COUNTED> counted {};
+	ASSERT_TRUE(harness_sorter(counted));
+	algorithms::powersort<vec_iter, 1, algorithms::COPY_BOTH_BIDIRECTIONAL> bidirectional {};
+	ASSERT_TRUE(harness_sorter(bidirectional));
+	algorithms::powersort<vec_iter, 8, algorithms::COPY_BOTH, false, algorithms::MOST_SIGNIFICANT_SET_BIT, false, true> trimmed {};
+	ASSERT_TRUE(harness_sorter(trimmed));
+	algorithms::powersort<vec_iter, 1, algorithms::COPY_BOTH_WITH_SENTINELS, false, algorithms::MOST_SIGNIFICANT_SET_BIT, false, false, true> halfBuffer {};
+	ASSERT_TRUE(harness_sorter(halfBuffer));
+	algorithms::powersort<vec_iter, 1, algorithms::COPY_SMALLER, false, algorithms::MOST_SIGNIFICANT_SET_BIT, false, true, true> halfBufferTrimmed {};
+	ASSERT_TRUE(harness_sorter(halfBufferTrimmed));
+	algorithms::powersort<vec_iter, 24, algorithms::COPY_BOTH, false, algorithms::MOST_SIGNIFICANT_SET_BIT, false, false, false, algorithms::SORTING_NETWORK> network {};
+	ASSERT_TRUE(harness_sorter(network));
+	algorithms::keyed_powersort<vec_iter, data::sort_key<int>, 1> keyed {};
+	ASSERT_TRUE(harness_sorter(keyed));
+	algorithms::indirect_sorter<vec_iter> indirect {};
+	ASSERT_TRUE(harness_sorter(indirect));
+	algorithms::pingpong_powersort<vec_iter, 1> pingpong {};
+	ASSERT_TRUE(harness_sorter(pingpong));
+	algorithms::pingpong_powersort<vec_iter, 24, algorithms::SORTING_NETWORK> pingpongNetwork {};
+	ASSERT_TRUE(harness_sorter(pingpongNetwork));
 
 }
 
@@ -441,13 +846,575 @@ TEST(harness, harnessPowersort4Way) {
     ASSERT_TRUE(harness_sorter(divisionPower));
     algorithms::powersort_4way<vec_iter, 1, algorithms::WILLEM, false, algorithms::MOST_SIGNIFICANT_SET_BIT4> msbsPower {};
     ASSERT_TRUE(harness_sorter(msbsPower));
+    algorithms::powersort_4way<vec_iter, 8, algorithms::GENERAL_BY_STAGES_SPLIT, false, algorithms::MOST_SIGNIFICANT_SET_BIT4,
+            false, true, true, true> trimmed {};
+    ASSERT_TRUE(harness_sorter(trimmed));
+    algorithms::powersort_4way<vec_iter, 1, algorithms::WILLEM_TUNED, false, algorithms::MOST_SIGNIFICANT_SET_BIT4,
+            false, true, true, false, true> halfBuffer {};
+    ASSERT_TRUE(harness_sorter(halfBuffer));
+}
+
+TEST(merging, loserTreeMerge) {
+    // equal keys; blob<2> keys are cached in the nodes, blob<8> are not
+    using small = stable_item;
+    using large = data::blob<8, int, data::FIRST_ENTRY>;
+    inputs::RNG rng2(23);
+    for (unsigned k : {2u, 3u, 4u, 5u, 8u, 13u, 16u, 64u}) {
+        for (int rep = 0; rep < 20; ++rep) {
+            int n = inputs::next_int(2000, rng2);
+            std::vector<small> a(n);
+            std::vector<large> b(n);
+            for (int i = 0; i < n; ++i) {
+                a[i].a[0] = b[i].a[0] = inputs::next_int(50, rng2);
+                a[i].a[1] = b[i].a[1] = i;
+            }
+            // k sorted runs, some of them empty
+            std::vector<int> boundaries {0, n};
+            for (unsigned i = 1; i < k; ++i) boundaries.push_back(inputs::next_int(n + 1, rng2));
+            std::sort(boundaries.begin(), boundaries.end());
+            std::vector<small *> g;
+            std::vector<large *> h;
+            for (int x : boundaries) g.push_back(a.data() + x), h.push_back(b.data() + x);
+            for (unsigned i = 0; i < k; ++i) {
+                std::stable_sort(g[i], g[i + 1]);
+                std::stable_sort(h[i], h[i + 1]);
+            }
+            const auto inputA = a;
+            const auto inputB = b;
+            std::vector<small> bufferA(n);
+            std::vector<large> bufferB(n);
+            algorithms::merge_kruns(g.data(), k, bufferA.data());
+            algorithms::merge_kruns(h.data(), k, bufferB.data());
+            ASSERT_TRUE(is_stable_sort_of(inputA.begin(), inputA.end(), a.begin()));
+            ASSERT_TRUE(is_stable_sort_of(inputB.begin(), inputB.end(), b.begin()));
+        }
+    }
+    // non-trivial elements
+    std::vector<data::heap_string> s;
+    algorithms::scratch_space<data::heap_string> buffer(7);
+    for (long long x : {1, 4, 7, 2, 3, 9, 0}) s.emplace_back(x);
+    data::heap_string *g[] = {s.data(), s.data() + 3, s.data() + 3, s.data() + 6, s.data() + 7};
+    algorithms::merge_kruns<4>(g, 4, buffer.get(7));
+    for (int i = 0; i < 7; ++i) ASSERT_EQ((std::vector<long long> {0, 1, 2, 3, 4, 7, 9})[i], s[i].value());
+}
+
+TEST(harness, harnessPowersortKWay) {
+    algorithms::powersort_kway<vec_iter, 2, 1> twoWay {};
+    ASSERT_TRUE(harness_sorter(twoWay));
+    algorithms::powersort_kway<vec_iter, 4, 1> fourWay {};
+    ASSERT_TRUE(harness_sorter(fourWay));
+    algorithms::powersort_kway<vec_iter, 8, 1, algorithms::COPY_BOTH_WITH_SENTINELS> eightWay {};
+    ASSERT_TRUE(harness_sorter(eightWay));
+    algorithms::powersort_kway<vec_iter, 16, 8, algorithms::COPY_SMALLER> sixteenWay {};
+    ASSERT_TRUE(harness_sorter(sixteenWay));
 }
 
 TEST(harness, harnessPowersort4WayWillem) {
+    algorithms::powersort_4way<vec_iter, 1, algorithms::LOSER_TREE> loserTree {};
+    ASSERT_TRUE(harness_sorter(loserTree));
+    algorithms::powersort_4way<vec_iter, 1, algorithms::WILLEM_COUNTED> counted {};
+    ASSERT_TRUE(harness_sorter(counted));
     algorithms::powersort_4way<vec_iter, 1, algorithms::WILLEM_VALUES> inMyP4 {};
     ASSERT_TRUE(harness_sorter(inMyP4));
 }
 
+TEST(harness, harnessParallelPowersort) {
+    algorithms::parallel_powersort<vec_iter, 24> def {4};
+    ASSERT_TRUE(harness_sorter(def));
+    algorithms::parallel_powersort<vec_iter, 1, algorithms::COPY_BOTH_WITH_SENTINELS> sentinels {3, 16};
+    ASSERT_TRUE(harness_sorter(sentinels));
+    algorithms::parallel_powersort<vec_iter, 8, algorithms::COPY_SMALLER> single {1};
+    ASSERT_TRUE(harness_sorter(single));
+}
+
+TEST(scratchSpace, sortersShareScratch) {
+    int n = 100000;
+    std::vector<int> input(n);
+    inputs::RNG rng2(11);
+    for (int i = 0; i < n; ++i) input[i] = inputs::next_int(1000, rng2);
+    inputs::sort_random_runs(input.begin(), input.end(), 300, rng2);
+    auto expected = input;
+    std::sort(expected.begin(), expected.end());
+    algorithms::powersort<int *> ps;
+    algorithms::powersort<int *, 24, algorithms::COPY_SMALLER, false, algorithms::MOST_SIGNIFICANT_SET_BIT,
+            false, false, true> psHalf;
+    algorithms::powersort_4way<int *> ps4;
+    algorithms::peeksort<int *> pks;
+    algorithms::top_down_mergesort<int *> td;
+    algorithms::bottom_up_mergesort<int *> bu;
+    algorithms::trotsort<int *> trot;
+    algorithms::parallel_powersort<int *> parallel {2, 1000};
+    algorithms::sorter<int *> *sorters[] = {&ps4, &ps, &psHalf, &pks, &td, &bu, &trot, &parallel};
+    algorithms::scratch_space<int> scratch;
+    long long largest = 0;
+    for (auto *s : sorters) {
+        auto a = input;
+        s->sort(a.data(), a.data() + n, scratch);
+        ASSERT_EQ(expected, a) << s->name();
+        largest = std::max(largest, s->scratch_elements());
+    }
+    // scratch only grows to the largest single request
+    ASSERT_EQ(largest, (long long) scratch.capacity());
+}
+
+TEST(moveSemantics, sortersOnHeapStrings) {
+    // moved-from strings are empty and would break the order if read or output again
+    using str = data::heap_string;
+    int n = 20000;
+    std::vector<str> input(n);
+    inputs::RNG rng2(5);
+    for (int i = 0; i < n; ++i) input[i] = inputs::next_int(2000, rng2);
+    inputs::sort_random_runs(input.begin(), input.end(), 100, rng2);
+    auto expected = input;
+    std::sort(expected.begin(), expected.end());
+    algorithms::powersort<str *, 8, algorithms::COPY_BOTH> ps;
+    algorithms::powersort<str *, 8, algorithms::COPY_BOTH_WITH_SENTINELS> psSentinels;
+    algorithms::powersort<str *, 8, algorithms::COPY_SMALLER> psSmaller;
+    algorithms::powersort<str *, 8, algorithms::GALLOPING> psGalloping;
+    algorithms::powersort<str *, 8, algorithms::COPY_BOTH_COUNTED> psCounted;
+    algorithms::powersort<str *, 8, algorithms::COPY_BOTH_BIDIRECTIONAL> psBidirectional;
+    algorithms::powersort<str *, 8, algorithms::UNSTABLE_BITONIC_MERGE> psBitonic;
+    algorithms::powersort<str *, 8, algorithms::UNSTABLE_BITONIC_MERGE_MANUAL_COPY> psBitonicManual;
+    algorithms::powersort<str *, 8, algorithms::COPY_SMALLER, false, algorithms::MOST_SIGNIFICANT_SET_BIT,
+            false, false, true> psHalf;
+    algorithms::powersort<str *, 8, algorithms::COPY_BOTH> psParallel {3, 1000};
+    algorithms::powersort_4way<str *, 8, algorithms::WILLEM_TUNED> ps4Willem;
+    algorithms::powersort_4way<str *, 8, algorithms::WILLEM_WITH_INDICES> ps4Indices;
+    algorithms::powersort_4way<str *, 8, algorithms::GENERAL_BY_STAGES> ps4Stages;
+    algorithms::powersort_4way<str *, 8, algorithms::GENERAL_BY_STAGES_SPLIT> ps4Split;
+    algorithms::powersort_4way<str *, 8, algorithms::GENERAL_NO_SENTINELS> ps4NoSentinels;
+    algorithms::powersort_4way<str *, 8, algorithms::WILLEM_COUNTED> ps4Counted;
+    algorithms::pingpong_powersort<str *, 8> psPingPong;
+    algorithms::powersort_4way<str *, 8, algorithms::GENERAL_BY_STAGES_SPLIT> ps4Parallel {3, 1000};
+    algorithms::peeksort<str *, 8> pks;
+    algorithms::top_down_mergesort<str *, 8> td;
+    algorithms::bottom_up_mergesort<str *, 8> bu;
+    algorithms::trotsort<str *, true> trot;
+    algorithms::parallel_powersort<str *, 8> parallel {3, 1000, 1000};
+    algorithms::sorter<str *> *sorters[] = {&ps, &psSentinels, &psSmaller, &psGalloping, &psBitonic, &psBitonicManual,
+            &psCounted, &psBidirectional, &psHalf, &psParallel, &ps4Willem, &ps4Indices, &ps4Stages, &ps4Split, &ps4NoSentinels,
+            &ps4Counted, &ps4Parallel, &psPingPong,
+            &pks, &td, &bu, &trot, &parallel};
+    for (auto *s : sorters) {
+        auto a = input;
+        s->sort(a.data(), a.data() + n);
+        ASSERT_EQ(expected, a) << s->name();
+    }
+}
+
+/** an int that counts its live instances and default constructions */
+struct counted_int {
+    static inline std::atomic<long long> live {0}, defaultConstructions {0};
+    int value;
+    counted_int() : value(0) { ++live; ++defaultConstructions; }
+    counted_int(int value) : value(value) { ++live; }
+    counted_int(const counted_int &other) : value(other.value) { ++live; }
+    counted_int(counted_int &&other) noexcept : value(other.value) { ++live; }
+    counted_int &operator=(const counted_int &) = default;
+    counted_int &operator=(counted_int &&) = default;
+    ~counted_int() { --live; }
+    bool operator<(const counted_int &rhs) const { return value < rhs.value; }
+    bool operator>(const counted_int &rhs) const { return rhs.value < value; }
+    bool operator<=(const counted_int &rhs) const { return !(rhs.value < value); }
+    bool operator>=(const counted_int &rhs) const { return !(value < rhs.value); }
+};
+
+TEST(scratchSpace, buffersHoldNoElementsBetweenSorts) {
+    // scratch space is raw storage: merges construct elements in it and destroy them again
+    using elem = counted_int;
+    int n = 20000;
+    std::vector<int> values(n);
+    inputs::RNG rng2(37);
+    for (int i = 0; i < n; ++i) values[i] = inputs::next_int(2000, rng2);
+    inputs::sort_random_runs(values.begin(), values.end(), 100, rng2);
+    const std::vector<elem> input(values.begin(), values.end());
+    std::sort(values.begin(), values.end());
+    algorithms::powersort<elem *, 8, algorithms::COPY_BOTH> ps;
+    algorithms::powersort<elem *, 8, algorithms::COPY_SMALLER> psSmaller;
+    algorithms::powersort<elem *, 8, algorithms::GALLOPING> psGalloping;
+    algorithms::powersort<elem *, 8, algorithms::COPY_BOTH_BIDIRECTIONAL> psBidirectional;
+    algorithms::powersort<elem *, 8, algorithms::COPY_SMALLER, false, algorithms::MOST_SIGNIFICANT_SET_BIT,
+            false, false, true> psHalf;
+    algorithms::powersort<elem *, 8, algorithms::COPY_BOTH> psParallel {3, 1000};
+    algorithms::powersort_4way<elem *, 8, algorithms::GENERAL_BY_STAGES_SPLIT> ps4Split;
+    algorithms::powersort_4way<elem *, 8, algorithms::LOSER_TREE> ps4LoserTree;
+    algorithms::powersort_4way<elem *, 8, algorithms::WILLEM_COUNTED> ps4Counted;
+    algorithms::powersort_4way<elem *, 8, algorithms::GENERAL_BY_STAGES_SPLIT> ps4Parallel {3, 1000};
+    algorithms::powersort_kway<elem *, 8, 8> psKWay;
+    algorithms::pingpong_powersort<elem *, 8> psPingPong;
+    algorithms::peeksort<elem *, 8> pks;
+    algorithms::trotsort<elem *, true> trot;
+    algorithms::parallel_powersort<elem *, 8> parallel {3, 1000, 1000};
+    algorithms::sorter<elem *> *sorters[] = {&ps, &psSmaller, &psGalloping, &psBidirectional, &psHalf, &psParallel,
+            &ps4Split, &ps4LoserTree, &ps4Counted, &ps4Parallel, &psKWay, &psPingPong, &pks, &trot, &parallel};
+    elem::defaultConstructions = 0;
+    algorithms::scratch_space<elem> scratch(n + 4);
+    ASSERT_EQ(0, elem::defaultConstructions.load());
+    for (auto *s : sorters) {
+        auto a = input;
+        const long long live = elem::live.load();
+        s->sort(a.data(), a.data() + n, scratch);
+        ASSERT_EQ(live, elem::live.load()) << s->name();
+        for (int i = 0; i < n; ++i) ASSERT_EQ(values[i], a[i].value) << s->name();
+    }
+    ASSERT_EQ(0, elem::defaultConstructions.load());
+}
+
+TEST(externalPowersort, sortsFileInChunks) {
+    namespace fs = std::filesystem;
+    const std::string dir = (fs::temp_directory_path() / "external-powersort-test").string();
+    fs::remove_all(dir);
+    fs::create_directory(dir);
+    auto write = [](const std::string &file, const std::vector<int> &a) {
+        std::FILE *f = std::fopen(file.c_str(), "wb");
+        ASSERT_EQ(a.size(), std::fwrite(a.data(), sizeof(int), a.size(), f));
+        std::fclose(f);
+    };
+    auto read = [](const std::string &file) {
+        std::vector<int> a(fs::file_size(file) / sizeof(int));
+        std::FILE *f = std::fopen(file.c_str(), "rb");
+        EXPECT_EQ(a.size(), std::fread(a.data(), sizeof(int), a.size(), f));
+        std::fclose(f);
+        return a;
+    };
+    // a sorted prefix spanning several chunks, then random runs
+    int n = 100000;
+    std::vector<int> input(n);
+    inputs::RNG rng2(17);
+    for (int i = 0; i < n; ++i) input[i] = inputs::next_int(50000, rng2);
+    std::sort(input.begin(), input.begin() + n / 4);
+    inputs::sort_random_runs(input.begin() + n / 4, input.end(), 5000, rng2);
+    auto expected = input;
+    std::sort(expected.begin(), expected.end());
+    write(dir + "/in", input);
+
+    algorithms::external_powersort<int> eps(3000, 100);
+    eps.sort(dir + "/in", dir + "/out");
+    ASSERT_EQ(expected, read(dir + "/out"));
+    ASSERT_GT(eps.merge_cost(), 0);
+    ASSERT_EQ(2, std::distance(fs::directory_iterator(dir), fs::directory_iterator())); // temporary files removed
+
+    // sorted chunks are concatenated without merging
+    eps.sort(dir + "/out", dir + "/out2");
+    ASSERT_EQ(expected, read(dir + "/out2"));
+    ASSERT_EQ(0, eps.merge_cost());
+
+    write(dir + "/empty", {});
+    eps.sort(dir + "/empty", dir + "/out3");
+    ASSERT_TRUE(read(dir + "/out3").empty());
+    fs::remove_all(dir);
+}
+
+TEST(streamingPowersort, batchesGiveStableSortedResult) {
+    using item = stable_item;
+    int n = 100000;
+    inputs::RNG rng2(23);
+    auto a = new_stable_items(n, 500, rng2);
+    inputs::sort_random_runs(a.begin(), a.end(), 300, rng2);
+    std::reverse(a.begin() + n / 2, a.begin() + n / 2 + 5000); // a long descending run
+    // hints below n force doublings of the bound
+    for (size_t expectedSize : {(size_t) n, (size_t) 1000, (size_t) 1}) {
+        algorithms::streaming_powersort<item, 16> sps {expectedSize};
+        for (int i = 0; i < n; ) {
+            int batch = std::min(n - i, 1 + inputs::next_int(3000, rng2));
+            sps.append(a.begin() + i, a.begin() + i + batch);
+            i += batch;
+            ASSERT_LE(sps.pending_runs(), 2 * algorithms::floor_log2((size_t) i) + 2);
+        }
+        auto b = sps.finish();
+        ASSERT_EQ(n, b.size());
+        ASSERT_TRUE(is_stable_sort_of(a.begin(), a.end(), b.begin()));
+        ASSERT_EQ(0, sps.size());
+    }
+    algorithms::streaming_powersort<int> empty;
+    ASSERT_TRUE(empty.finish().empty());
+}
+
+TEST(streamingPowersort, longRunsOneElementAtATime) {
+    // a run that is still growing must not be rescanned from its start on every append
+    using elem = data::comp_counter;
+    const int n = 200000;
+    for (bool ascending : {true, false}) {
+        algorithms::streaming_powersort<elem> sps {16};
+        data::totalComparisons = 0;
+        for (int i = 0; i < n; ++i) {
+            elem x = ascending ? i : n - i;
+            sps.append(&x, &x + 1);
+        }
+        auto result = sps.finish();
+        ASSERT_LE(data::totalComparisons, 2LL * n);
+        ASSERT_EQ((size_t) n, result.size());
+        for (int i = 0; i < n; ++i) ASSERT_EQ(elem {ascending ? i : i + 1}, result[i]);
+    }
+}
+
+TEST(incrementalPowersort, sortedPrefixAndDirtyRanges) {
+    int n = 50000;
+    inputs::RNG rng2(7);
+    algorithms::powersort<stable_item *, 16, algorithms::COPY_SMALLER> ps;
+    algorithms::scratch_space<stable_item> scratch;
+    for (int k : {0, 1, 100, 5000, n}) {
+        auto a = new_stable_items(n, 1000, rng2);
+        std::stable_sort(a.begin(), a.end() - k);
+        const auto input = a;
+        ps.sort_with_sorted_prefix(&a[0], &a[0] + (n - k), &a[0] + n, scratch);
+        ASSERT_TRUE(is_stable_sort_of(input.begin(), input.end(), a.begin()));
+    }
+    // change elements in three ranges of a sorted array
+    std::vector<int> a(n);
+    for (int i = 0; i < n; ++i) a[i] = 2 * i;
+    std::vector<std::pair<int *, int *>> dirty {
+            {&a[10], &a[20]}, {&a[20], &a[25]}, {&a[30000], &a[32000]}, {&a[n - 3], &a[n]}};
+    for (auto &range : dirty)
+        for (int *p = range.first; p < range.second; ++p) *p = inputs::next_int(2 * n, rng2);
+    auto expected = a;
+    std::sort(expected.begin(), expected.end());
+    algorithms::powersort<int *> ps2;
+    ps2.sort_dirty_ranges(&a[0], &a[0] + n, dirty);
+    ASSERT_EQ(expected, a);
+    // without a known unsorted suffix, appended_powersort sorts everything
+    algorithms::appended_powersort<int *> appended(std::numeric_limits<size_t>::max());
+    ASSERT_NE(std::string::npos, appended.name().find("+k=unknown+")) << appended.name();
+    std::shuffle(a.begin(), a.end(), rng2);
+    appended.sort(&a[0], &a[0] + n);
+    ASSERT_EQ(expected, a);
+}
+
+TEST(keyedPowersort, soaAndKeyedRecords) {
+    int n = 30000;
+    inputs::RNG rng2(11);
+    // keys with two parallel payload arrays; equal keys keep the order of their payloads
+    std::vector<long> keys(n);
+    std::vector<int> original(n);
+    std::vector<std::string> names(n);
+    for (int i = 0; i < n; ++i) {
+        keys[i] = inputs::next_int(500, rng2);
+        original[i] = i;
+        names[i] = std::to_string(i);
+    }
+    std::vector<std::pair<long, int>> expected(n);
+    for (int i = 0; i < n; ++i) expected[i] = {keys[i], i};
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const auto &x, const auto &y) { return x.first < y.first; });
+    algorithms::soa_powersort<long, 16> soa;
+    soa.sort(keys.data(), keys.data() + n, original.data(), names.data());
+    for (int i = 0; i < n; ++i) {
+        ASSERT_EQ(expected[i].first, keys[i]);
+        ASSERT_EQ(expected[i].second, original[i]);
+        ASSERT_EQ(std::to_string(expected[i].second), names[i]);
+    }
+    // further sorts reuse the caller's scratch space for both payload types
+    algorithms::payload_scratch scratch;
+    soa.sort(keys.data(), keys.data() + n, scratch, original.data(), names.data());
+    const size_t capacity = scratch.capacity();
+    soa.sort(keys.data(), keys.data() + n, scratch, original.data(), names.data());
+    ASSERT_EQ(capacity, scratch.capacity());
+    for (int i = 0; i < n; ++i) ASSERT_EQ(expected[i].second, original[i]);
+    // non-arithmetic keys are not packed (and hence stay aligned)
+    std::vector<std::string> stringKeys(names.rbegin(), names.rend());
+    algorithms::keyed_powersort<std::string *, data::sort_key<std::string>> stringKps;
+    stringKps.sort(stringKeys.data(), stringKeys.data() + n);
+    ASSERT_TRUE(std::is_sorted(stringKeys.begin(), stringKeys.end()));
+    // records compared by their first entry
+    using item = data::blob<4, int, data::FIRST_ENTRY>;
+    auto a = new_stable_items<item>(n, 100, rng2);
+    inputs::sort_random_runs(a.begin(), a.end(), 100, rng2);
+    algorithms::keyed_powersort<item *, data::sort_key<item>> kps;
+    ASSERT_TRUE(harness_stable_sorter(kps, a));
+    ASSERT_THROW((algorithms::check_index_range<uint8_t>(257)), std::length_error);
+    algorithms::check_index_range<uint8_t>(256);
+}
+
+TEST(indirectSort, stableAndPermutesInPlace) {
+    std::vector<unsigned> order {3, 0, 4, 1, 2, 5, 7, 6};
+    std::vector<std::string> records {"a", "b", "c", "d", "e", "f", "g", "h"};
+    algorithms::permute_in_place(records.begin(), order.data(), order.size());
+    ASSERT_EQ((std::vector<std::string> {"d", "a", "e", "b", "c", "f", "h", "g"}), records);
+    for (unsigned i = 0; i < order.size(); ++i) ASSERT_EQ(i, order[i]);
+    using item = data::blob<32, int, data::FIRST_ENTRY>;
+    inputs::RNG rng2(13);
+    auto a = new_stable_items<item>(20000, 200, rng2);
+    inputs::sort_random_runs(a.begin(), a.end(), 50, rng2);
+    algorithms::indirect_sorter<item *, uint32_t> indirect32;
+    ASSERT_TRUE(harness_stable_sorter(indirect32, a));
+    algorithms::indirect_sorter<item *, uint64_t> indirect64;
+    ASSERT_TRUE(harness_stable_sorter(indirect64, a));
+}
+
+TEST(indirectSort, stableArgsort) {
+    int n = 50000;
+    inputs::RNG rng2(17);
+    std::vector<double> keys(n);
+    for (int i = 0; i < n; ++i) keys[i] = inputs::next_int(1000, rng2) / 8.0;
+    inputs::sort_random_runs(keys.begin(), keys.end(), 300, rng2);
+    std::vector<uint32_t> expected(n);
+    for (int i = 0; i < n; ++i) expected[i] = i;
+    std::stable_sort(expected.begin(), expected.end(), [&](uint32_t i, uint32_t j) { return keys[i] < keys[j]; });
+    auto before = keys;
+    ASSERT_EQ(expected, algorithms::stable_argsort(keys.begin(), keys.end()));
+    ASSERT_EQ(expected, (algorithms::stable_argsort<uint32_t, algorithms::powersort_4way>(keys.data(), keys.data() + n)));
+    algorithms::argsorter<double *, uint64_t, algorithms::powersort_4way> argsorter4;
+    std::vector<uint64_t> permutation(n);
+    argsorter4.sort_permutation(keys.data(), keys.data() + n, permutation.data());
+    for (int i = 0; i < n; ++i) ASSERT_EQ(expected[i], permutation[i]);
+    ASSERT_EQ(before, keys);
+    ASSERT_TRUE(algorithms::stable_argsort(keys.begin(), keys.begin()).empty());
+}
+
+TEST(indirectSort, multithreadedSorterAndConcurrentArgsorts) {
+    int n = 50000;
+    inputs::RNG rng2(23);
+    std::vector<std::vector<double>> keys(3, std::vector<double>(n));
+    std::vector<std::vector<uint32_t>> expected(3, std::vector<uint32_t>(n));
+    for (int t = 0; t < 3; ++t) {
+        for (int i = 0; i < n; ++i) keys[t][i] = inputs::next_int(1000, rng2) / 8.0;
+        for (int i = 0; i < n; ++i) expected[t][i] = i;
+        std::stable_sort(expected[t].begin(), expected[t].end(),
+                         [&](uint32_t i, uint32_t j) { return keys[t][i] < keys[t][j]; });
+    }
+    // worker threads of the sorter compare indices
+    algorithms::argsorter<double *, uint32_t, algorithms::parallel_powersort> parallel {4, 1000};
+    ASSERT_EQ(expected[0], parallel.sort_permutation(keys[0].data(), keys[0].data() + n));
+    algorithms::argsorter<double *, uint64_t, algorithms::parallel_powersort> parallel64 {4, 1000};
+    auto permutation64 = parallel64.sort_permutation(keys[1].data(), keys[1].data() + n);
+    ASSERT_TRUE(std::equal(expected[1].begin(), expected[1].end(), permutation64.begin()));
+    // argsorts in different threads, and argsorts nested in tasks of another one, run independently
+    std::vector<std::vector<uint32_t>> results(3);
+    std::vector<std::thread> threads;
+    for (int t = 1; t < 3; ++t)
+        threads.emplace_back([&, t] { results[t] = algorithms::stable_argsort(keys[t].data(), keys[t].data() + n); });
+    algorithms::work_stealing_pool pool {3};
+    {
+        const auto binding = algorithms::indirect_index<double, uint32_t>::bind_records(keys[0].data());
+        pool.parallel_for(8, [&](size_t i) {
+            ASSERT_EQ(keys[0].data(), (algorithms::indirect_index<double, uint32_t>::records));
+            if (i == 5) results[0] = parallel.sort_permutation(keys[0].data(), keys[0].data() + n);
+            ASSERT_EQ(keys[0].data(), (algorithms::indirect_index<double, uint32_t>::records));
+        });
+    }
+    for (auto &thread : threads) thread.join();
+    ASSERT_EQ(expected, results);
+    ASSERT_EQ(nullptr, (algorithms::indirect_index<double, uint32_t>::records));
+}
+
+TEST(inputs, testSortedPlusRandomGenerator) {
+    inputs::sorted_plus_random_generator<int> gen {100};
+    inputs::RNG rng2(5);
+    int *A = gen.newInstance(1000, rng2);
+    ASSERT_TRUE(std::is_sorted(A, A + 900));
+    ASSERT_FALSE(std::is_sorted(A, A + 1000));
+    A = gen.reuseInstance(1000, A, rng2);
+    ASSERT_TRUE(std::is_sorted(A, A + 900));
+    std::sort(A, A + 1000);
+    for (int i = 0; i < 1000; ++i) ASSERT_EQ(i + 1, A[i]);
+    delete[] A;
+    ASSERT_EQ(100, gen.unsorted_suffix());
+}
+
+TEST(parallelPowersort, sameResultAsSequential) {
+    inputs::RNG rng2(42);
+    auto a = new_stable_items(200000, 100, rng2);
+    inputs::sort_random_runs(a.begin(), a.end(), 1000, rng2);
+    algorithms::powersort<stable_item *> sequential;
+    ASSERT_TRUE(harness_stable_sorter(sequential, a));
+    algorithms::parallel_powersort<stable_item *> parallel {4, 1000};
+    ASSERT_TRUE(harness_stable_sorter(parallel, a));
+}
+
+TEST(parallelPowersort, chunkedRunDetectionMatchesScan) {
+    // ascending and descending runs of varying length with many equal keys
+    inputs::RNG rng2(7);
+    std::vector<int> a;
+    while (a.size() < 100000) {
+        int len = 1 + inputs::next_int(200, rng2), x = inputs::next_int(1000, rng2);
+        bool desc = inputs::next_int(2, rng2);
+        for (int i = 0; i < len; ++i) {
+            a.push_back(x);
+            x += (desc ? -1 : 1) * inputs::next_int(3, rng2);
+        }
+    }
+    for (unsigned minTaskSize : {2u, 7u, 100u, 5000u}) {
+        auto serialInput = a, chunkedInput = a;
+        algorithms::parallel_powersort<int *, 16> serial {1, (size_t) a.size() + 1};
+        serial.find_runs(serialInput.data(), serialInput.data() + a.size());
+        algorithms::parallel_powersort<int *, 16> chunked {3, minTaskSize};
+        chunked.find_runs(chunkedInput.data(), chunkedInput.data() + a.size());
+        ASSERT_EQ(serialInput, chunkedInput);
+        ASSERT_EQ(serial.run_boundaries().size(), chunked.run_boundaries().size());
+        for (size_t i = 0; i < serial.run_boundaries().size(); ++i)
+            ASSERT_EQ(serial.run_boundaries()[i] - serialInput.data(),
+                      chunked.run_boundaries()[i] - chunkedInput.data());
+    }
+}
+
+TEST(harness, harnessParallelMerges) {
+    algorithms::powersort<vec_iter, 1> ps {3, 50};
+    ASSERT_TRUE(harness_sorter(ps));
+    algorithms::powersort_4way<vec_iter, 1, algorithms::GENERAL_BY_STAGES> ps4 {3, 50};
+    ASSERT_TRUE(harness_sorter(ps4));
+    algorithms::powersort_4way<vec_iter, 1, algorithms::GENERAL_BY_STAGES, false, algorithms::MOST_SIGNIFICANT_SET_BIT4,
+            false, true, false> ps4NoSpecialized3way {2, 50};
+    ASSERT_TRUE(harness_sorter(ps4NoSpecialized3way));
+    algorithms::parallel_powersort<vec_iter, 1> parallel {3, 16, 50};
+    ASSERT_TRUE(harness_sorter(parallel));
+}
+
+TEST(mergeParallel, coRankSplitsStably) {
+    // ties must be broken in favor of the first run
+    std::vector<int> a {1, 2, 2, 2, 5, 7}, b {0, 2, 2, 3, 7};
+    for (ptrdiff_t k = 0; k <= 11; ++k) {
+        ptrdiff_t i = algorithms::co_rank(k, a.begin(), 6, b.begin(), 5), j = k - i;
+        ASSERT_TRUE(0 <= i && i <= 6 && 0 <= j && j <= 5);
+        if (i > 0 && j < 5) {
+            ASSERT_TRUE(a[i - 1] <= b[j]);
+        }
+        if (j > 0 && i < 6) {
+            ASSERT_TRUE(b[j - 1] < a[i]);
+        }
+    }
+}
+
+TEST(mergeParallel, parallelMergesMatchSequential) {
+    inputs::RNG rng2(3);
+    for (int n : {0, 1, 5, 100, 10007}) {
+        std::vector<int> a(n), expected;
+        for (int &x : a) x = inputs::next_int(n / 4 + 1, rng2);
+        int g1 = n / 7, g2 = n / 3, g3 = n / 3 + n / 5;
+        std::sort(a.begin(), a.begin() + g1); std::sort(a.begin() + g1, a.begin() + g2);
+        std::sort(a.begin() + g2, a.begin() + g3); std::sort(a.begin() + g3, a.end());
+        expected = a;
+        std::sort(expected.begin(), expected.end());
+        std::vector<int> B(n);
+        for (unsigned threads : {1u, 2u, 5u}) {
+            algorithms::work_stealing_pool pool {threads};
+            auto b = a;
+            algorithms::parallel_merge_runs(b.begin(), b.begin() + g1, b.begin() + g2, B.begin(), pool);
+            algorithms::parallel_merge_runs(b.begin(), b.begin() + g2, b.begin() + g3, B.begin(), pool);
+            algorithms::parallel_merge_runs(b.begin(), b.begin() + g3, b.end(), B.begin(), pool);
+            ASSERT_EQ(expected, b);
+            b = a;
+            algorithms::parallel_merge_3runs(b.begin(), b.begin() + g1, b.begin() + g2, b.begin() + g3, B.begin(), pool);
+            algorithms::parallel_merge_runs(b.begin(), b.begin() + g3, b.end(), B.begin(), pool);
+            ASSERT_EQ(expected, b);
+            b = a;
+            algorithms::parallel_merge_4runs(b.begin(), b.begin() + g1, b.begin() + g2, b.begin() + g3, b.end(), B.begin(), pool);
+            ASSERT_EQ(expected, b);
+        }
+    }
+}
+
+TEST(harness, harnessInPlaceMerging) {
+	algorithms::powersort<vec_iter, 1, algorithms::IN_PLACE_SYMMERGE> ps;
+	ASSERT_TRUE(harness_sorter(ps));
+	ASSERT_EQ(0, ps.scratch_elements());
+	algorithms::peeksort<vec_iter, 1, false, algorithms::IN_PLACE_SYMMERGE> pk;
+	ASSERT_TRUE(harness_sorter(pk));
+	ASSERT_EQ(0, pk.scratch_elements());
+	algorithms::bottom_up_mergesort<vec_iter, 8, true, algorithms::IN_PLACE_SYMMERGE> bu;
+	ASSERT_TRUE(harness_sorter(bu));
+	ASSERT_EQ(0, bu.scratch_elements());
+}
+
 TEST(harness, harnessTimsort) {
 	algorithms::timsort<vec_iter> tim;
 	ASSERT_TRUE(harness_sorter(tim));
@@ -459,6 +1426,8 @@ TEST(harness, harnessTrotsort) {
 	ASSERT_TRUE(harness_sorter(tim));
 	algorithms::trotsort<vec_iter,true> timBin;
 	ASSERT_TRUE(harness_sorter(timBin));
+	algorithms::trotsort<vec_iter,false,algorithms::GALLOPING> timGallop;
+	ASSERT_TRUE(harness_sorter(timGallop));
 }
 
 
@@ -547,11 +1516,46 @@ TEST(nodePowers, nodePowers4Examples) {
 	ASSERT_EQ(algorithms::node_power4_div(0, 21 + 1, 19, 20, 20 + 1), 3);
 	ASSERT_EQ(algorithms::node_power4_div(0, 100 * 1000 * 1000 + 1, 55555555, 55555666, 55556666 + 1), 8);
 
+	ASSERT_EQ(algorithms::node_power_kway_clz<8>(1, 100 + 1, 10, 20, 25 + 1), 2);
+	ASSERT_EQ(algorithms::node_power_kway_clz<8>(0, 21 + 1, 8, 12, 13 + 1), 1);
+	ASSERT_EQ(algorithms::node_power_kway_clz<8>(0, 21 + 1, 19, 20, 20 + 1), 2);
+	ASSERT_EQ(algorithms::node_power_kway_clz<8>(0, 100 * 1000 * 1000 + 1, 55555555, 55555666, 55556666 + 1), 6);
+
 }
 
 
 
 
+TEST(nodePowers, nodePowersBeyond32Bits) {
+	// exact clz-based powers must agree with the bitwise loop, also across the switch to 128-bit division
+	inputs::RNG rng2(3);
+	for (size_t n : {(1ul << 31) - 1, 1ul << 31, (1ul << 31) + 1, (1ul << 32) + 5, 16000000000ul, 1ul << 40, (1ul << 62) - 1}) {
+		for (int rep = 0; rep < 1000; ++rep) {
+			size_t x[3];
+			for (auto &xi : x) xi = inputs::next_index(n, rng2);
+			std::sort(x, x + 3);
+			if (x[0] == x[1] || x[1] == x[2]) continue;
+			ASSERT_EQ(algorithms::node_power_bitwise(0, n, x[0], x[1], x[2]),
+			          algorithms::node_power_clz(0, n, x[0], x[1], x[2])) << n;
+			ASSERT_EQ(algorithms::node_power4_bitwise(0, n, x[0], x[1], x[2]),
+			          algorithms::node_power4_clz(0, n, x[0], x[1], x[2])) << n;
+			ASSERT_EQ(algorithms::node_power_clz(0, n, x[0], x[1], x[2]),
+			          algorithms::node_power_kway_clz<2>(0, n, x[0], x[1], x[2])) << n;
+			ASSERT_EQ(algorithms::node_power4_clz(0, n, x[0], x[1], x[2]),
+			          algorithms::node_power_kway_clz<4>(0, n, x[0], x[1], x[2])) << n;
+			// a base-16 digit is two base-4 digits
+			ASSERT_EQ((algorithms::node_power4_clz(0, n, x[0], x[1], x[2]) - 1) / 2 + 1,
+			          algorithms::node_power_kway_clz<16>(0, n, x[0], x[1], x[2])) << n;
+		}
+		// neighboring short runs need the largest powers
+		ASSERT_EQ(algorithms::node_power_bitwise(0, n, n/2 - 1, n/2, n/2 + 1),
+		          algorithms::node_power_clz(0, n, n/2 - 1, n/2, n/2 + 1)) << n;
+		ASSERT_EQ(algorithms::node_power_bitwise(0, n, n - 3, n - 2, n - 1),
+		          algorithms::node_power_clz(0, n, n - 3, n - 2, n - 1)) << n;
+	}
+}
+
+
 
 TEST(welford, testVariance) {
     std::vector<double> v {1, 2, 3, 4, 5, 6, 7, 8, 9, 10,1, 2, 3, 4, 5, 6, 7, 8, 9, 10,1, 2, 3, 4, 5, 6, 7, 8, 9, 10,1, 2, 3, 4, 5, 6, 7, 8, 9, 10,};